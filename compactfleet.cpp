@@ -0,0 +1,315 @@
+// UMBC - CMSC 341 - Spring 2025 - Proj2
+#include "compactfleet.h"
+
+// Layout of Node::m_data
+const int TYPESHIFT = 17;
+const int STATESHIFT = 20;
+const int HEIGHTSHIFT = 21;
+const uint32_t IDMASK = (1u << TYPESHIFT) - 1;
+const uint32_t TYPEMASK = 7u << TYPESHIFT;
+const uint32_t STATEMASK = 1u << STATESHIFT;
+const uint32_t HEIGHTMASK = 31u << HEIGHTSHIFT;
+
+// Default constructor
+// Initializes an empty fleet, the node array is allocated on the first insert
+CompactFleet::CompactFleet() : m_nodes(nullptr), m_capacity(0), m_used(0), m_free(NILINDEX),
+                               m_root(NILINDEX), m_size(0){
+}
+
+// Copy constructor
+// The node array holds no pointers, so a copy is one block copy
+CompactFleet::CompactFleet(const CompactFleet& rhs) : CompactFleet(){
+    *this = rhs;
+}
+
+// Destructor
+CompactFleet::~CompactFleet(){
+    clear();
+}
+
+// Overloaded Assignment Operator
+// Deep copies another fleet object
+const CompactFleet & CompactFleet::operator=(const CompactFleet & rhs){
+    if (this != &rhs) {
+        clear();
+        if (rhs.m_used > 0) {
+            m_nodes = new Node[rhs.m_used];
+            for (uint32_t i = 0; i < rhs.m_used; i++)
+                m_nodes[i] = rhs.m_nodes[i];
+
+            m_capacity = rhs.m_used;
+        }
+        m_used = rhs.m_used;
+        m_free = rhs.m_free;
+        m_root = rhs.m_root;
+        m_size = rhs.m_size;
+    }
+    return *this;
+}
+
+// Deallocates the node array
+void CompactFleet::clear(){
+    delete[] m_nodes;
+    m_nodes = nullptr;
+    m_capacity = 0;
+    m_used = 0;
+    m_free = NILINDEX;
+    m_root = NILINDEX;
+    m_size = 0;
+}
+
+// Inserts a new Ship into the fleet and re-balances it
+void CompactFleet::insert(const Ship& ship){
+    // Skip insertion if ID out of range
+    if (ship.getID() < MINID || ship.getID() > MAXID)
+        return;
+
+    bool inserted = false;
+    m_root = insertHelper(m_root, ship, inserted);
+    if (inserted)
+        m_size++;
+}
+
+// Deletes a ship by ID and re-balances the fleet
+void CompactFleet::remove(int id){
+    if (m_root == NILINDEX || id < MINID || id > MAXID)
+        return;
+
+    bool removed = false;
+    m_root = removeHelper(m_root, id, removed);
+    if (removed)
+        m_size--;
+}
+
+// Returns true if a ship with the given ID is in the fleet
+bool CompactFleet::contains(int id) const{
+    Ship ship;
+    return peek(id, ship);
+}
+
+// Copies the ship with the given ID into ship, returns false if not found
+bool CompactFleet::peek(int id, Ship& ship) const{
+    uint32_t node = m_root;
+    while (node != NILINDEX && getID(node) != id)
+        node = (getID(node) > id) ? m_nodes[node].m_left : m_nodes[node].m_right;
+
+    if (node == NILINDEX)
+        return false;
+
+    uint32_t data = m_nodes[node].m_data;
+    ship = Ship(id, static_cast<SHIPTYPE>((data & TYPEMASK) >> TYPESHIFT),
+                static_cast<STATE>((data & STATEMASK) >> STATESHIFT));
+    return true;
+}
+
+// Returns the number of ships in the fleet
+int CompactFleet::size() const{
+    return m_size;
+}
+
+// Returns the ID stored in a node
+int CompactFleet::getID(uint32_t node) const {
+    return MINID + int(m_nodes[node].m_data & IDMASK);
+}
+
+// Returns the height of a subtree, -1 for an empty subtree
+int CompactFleet::height(uint32_t node) const {
+    if (node == NILINDEX)
+        return -1;
+
+    return int((m_nodes[node].m_data & HEIGHTMASK) >> HEIGHTSHIFT);
+}
+
+// Recomputes the height of a single node from its children
+void CompactFleet::updateNode(uint32_t node) {
+    int leftHeight = height(m_nodes[node].m_left);
+    int rightHeight = height(m_nodes[node].m_right);
+    uint32_t newHeight = uint32_t((leftHeight > rightHeight ? leftHeight : rightHeight) + 1);
+    m_nodes[node].m_data = (m_nodes[node].m_data & ~HEIGHTMASK) | (newHeight << HEIGHTSHIFT);
+}
+
+// Returns the index of a new leaf holding ship, growing the node array if needed.
+// The array may move, so callers must not hold references into it across this call
+uint32_t CompactFleet::allocate(const Ship& ship) {
+    uint32_t node = m_free;
+    if (node != NILINDEX)
+        m_free = m_nodes[node].m_left;
+
+    else {
+        if (m_used == m_capacity) {
+            uint32_t capacity = (m_capacity > 0) ? m_capacity * 2 : 64;
+            Node* nodes = new Node[capacity];
+            for (uint32_t i = 0; i < m_used; i++)
+                nodes[i] = m_nodes[i];
+
+            delete[] m_nodes;
+            m_nodes = nodes;
+            m_capacity = capacity;
+        }
+        node = m_used++;
+    }
+
+    m_nodes[node].m_left = NILINDEX;
+    m_nodes[node].m_right = NILINDEX;
+    m_nodes[node].m_data = uint32_t(ship.getID() - MINID) |
+                           (uint32_t(ship.getType()) << TYPESHIFT) |
+                           (uint32_t(ship.getState()) << STATESHIFT);
+    return node;
+}
+
+// Puts a slot on the free list for reuse
+void CompactFleet::release(uint32_t node) {
+    m_nodes[node].m_left = m_free;
+    m_free = node;
+}
+
+// Rotates a subtree to the left and returns its new root
+uint32_t CompactFleet::rotateLeft(uint32_t node) {
+    uint32_t rightChild = m_nodes[node].m_right;
+    m_nodes[node].m_right = m_nodes[rightChild].m_left;
+    m_nodes[rightChild].m_left = node;
+    updateNode(node);
+    updateNode(rightChild);
+    return rightChild;
+}
+
+// Rotates a subtree to the right and returns its new root
+uint32_t CompactFleet::rotateRight(uint32_t node) {
+    uint32_t leftChild = m_nodes[node].m_left;
+    m_nodes[node].m_left = m_nodes[leftChild].m_right;
+    m_nodes[leftChild].m_right = node;
+    updateNode(node);
+    updateNode(leftChild);
+    return leftChild;
+}
+
+// Restores the AVL property at a node whose children are balanced (LL, RR, LR, RL)
+// and returns the new root of the subtree
+uint32_t CompactFleet::rebalance(uint32_t node) {
+    updateNode(node);
+    uint32_t left = m_nodes[node].m_left;
+    uint32_t right = m_nodes[node].m_right;
+    int balanceFactor = height(left) - height(right);
+
+    // Left Heavy
+    if (balanceFactor > 1) {
+        // Left-Right Rotation
+        if (height(m_nodes[left].m_left) < height(m_nodes[left].m_right))
+            m_nodes[node].m_left = rotateLeft(left);
+
+        // Left-Left Rotation
+        return rotateRight(node);
+    }
+    // Right Heavy
+    if (balanceFactor < -1) {
+        // Right-Left Rotation
+        if (height(m_nodes[right].m_right) < height(m_nodes[right].m_left))
+            m_nodes[node].m_right = rotateRight(right);
+
+        // Right-Right Rotation
+        return rotateLeft(node);
+    }
+    return node;
+}
+
+// Recursively inserts a ship below node and returns the re-balanced subtree.
+// AVL depth is logarithmic, so the recursion is shallow
+uint32_t CompactFleet::insertHelper(uint32_t node, const Ship& ship, bool& inserted) {
+    if (node == NILINDEX) {
+        inserted = true;
+        return allocate(ship);
+    }
+
+    // No Duplicate IDs
+    int id = getID(node);
+    if (id == ship.getID())
+        return node;
+
+    // The array may grow below us, so store the child only after the call returns
+    if (id > ship.getID()) {
+        uint32_t child = insertHelper(m_nodes[node].m_left, ship, inserted);
+        m_nodes[node].m_left = child;
+    }
+    else {
+        uint32_t child = insertHelper(m_nodes[node].m_right, ship, inserted);
+        m_nodes[node].m_right = child;
+    }
+
+    return inserted ? rebalance(node) : node;
+}
+
+// Recursively removes the ship with the given ID below node and returns the
+// re-balanced subtree
+uint32_t CompactFleet::removeHelper(uint32_t node, int id, bool& removed) {
+    if (node == NILINDEX)
+        return NILINDEX;
+
+    Node& current = m_nodes[node];
+    if (getID(node) > id)
+        current.m_left = removeHelper(current.m_left, id, removed);
+
+    else if (getID(node) < id)
+        current.m_right = removeHelper(current.m_right, id, removed);
+
+    else {
+        removed = true;
+        uint32_t left = current.m_left;
+        uint32_t right = current.m_right;
+        release(node);
+
+        // Case 1 and 2: Leaf node or one child, the child takes its place
+        if (left == NILINDEX || right == NILINDEX)
+            return (left != NILINDEX) ? left : right;
+
+        // Case 3: Two children — replace using predecessor or successor
+        uint32_t replacement;
+        if (height(left) < height(right))
+            left = detachMax(left, replacement);
+
+        else
+            right = detachMin(right, replacement);
+
+        m_nodes[replacement].m_left = left;
+        m_nodes[replacement].m_right = right;
+        return rebalance(replacement);
+    }
+
+    return removed ? rebalance(node) : node;
+}
+
+// Unlinks the rightmost node of a subtree into max and returns the re-balanced subtree
+uint32_t CompactFleet::detachMax(uint32_t node, uint32_t& max) {
+    if (m_nodes[node].m_right == NILINDEX) {
+        max = node;
+        return m_nodes[node].m_left;
+    }
+
+    m_nodes[node].m_right = detachMax(m_nodes[node].m_right, max);
+    return rebalance(node);
+}
+
+// Unlinks the leftmost node of a subtree into min and returns the re-balanced subtree
+uint32_t CompactFleet::detachMin(uint32_t node, uint32_t& min) {
+    if (m_nodes[node].m_left == NILINDEX) {
+        min = node;
+        return m_nodes[node].m_right;
+    }
+
+    m_nodes[node].m_left = detachMin(m_nodes[node].m_left, min);
+    return rebalance(node);
+}
+
+void CompactFleet::dumpTree() const
+{
+    dump(m_root);
+}
+
+void CompactFleet::dump(uint32_t node) const{
+    if (node != NILINDEX){
+        cout << "(";
+        dump(m_nodes[node].m_left);//first visit the left child
+        cout << getID(node) << ":" << height(node);//second visit the node itself
+        dump(m_nodes[node].m_right);//third visit the right child
+        cout << ")";
+    }
+}
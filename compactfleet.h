@@ -0,0 +1,71 @@
+// UMBC - CMSC 341 - Spring 2025 - Proj2
+#ifndef COMPACTFLEET_H
+#define COMPACTFLEET_H
+#include "fleet.h"
+#include <cstdint>
+
+// Alternative storage for an AVL fleet. Nodes live in one contiguous array
+// and refer to their children by 32-bit index; the ID, type, state and height
+// are packed into a single word, so a node takes 12 bytes instead of a Ship's 40.
+// Packing the height into 5 bits relies on the AVL bound (a full 90k-ship
+// fleet is at most 24 levels deep), which is why this storage is AVL only.
+const uint32_t NILINDEX = 0xFFFFFFFF; // the index of an empty subtree
+
+class CompactFleet{
+    public:
+    friend class Grader;
+    friend class Tester;
+    CompactFleet();
+    CompactFleet(const CompactFleet& rhs);
+    ~CompactFleet();
+    const CompactFleet & operator=(const CompactFleet & rhs);
+    void clear();
+    void insert(const Ship& ship);
+    void remove(int id);
+    bool contains(int id) const;
+    bool peek(int id, Ship& ship) const;
+    int size() const;
+    void dumpTree() const;
+    private:
+    struct Node{
+        uint32_t m_left;  // the index of the left child
+        uint32_t m_right; // the index of the right child
+        uint32_t m_data;  // ID - MINID (17 bits), type (3 bits), state (1 bit), height (5 bits)
+    };
+    Node* m_nodes;      // every node of the tree, free slots are linked through m_left
+    uint32_t m_capacity;// the number of slots in m_nodes
+    uint32_t m_used;    // the number of slots handed out so far
+    uint32_t m_free;    // the first released slot
+    uint32_t m_root;    // the index of the root
+    int m_size;         // the number of ships in the fleet
+
+    // ***************************************************
+    // Any private helper functions must be declared here!
+    int getID(uint32_t node) const;
+
+    int height(uint32_t node) const;
+
+    void updateNode(uint32_t node);
+
+    uint32_t allocate(const Ship& ship);
+
+    void release(uint32_t node);
+
+    uint32_t rotateLeft(uint32_t node);
+
+    uint32_t rotateRight(uint32_t node);
+
+    uint32_t rebalance(uint32_t node);
+
+    uint32_t insertHelper(uint32_t node, const Ship& ship, bool& inserted);
+
+    uint32_t removeHelper(uint32_t node, int id, bool& removed);
+
+    uint32_t detachMax(uint32_t node, uint32_t& max);
+
+    uint32_t detachMin(uint32_t node, uint32_t& min);
+    // ***************************************************
+
+    void dump(uint32_t node) const;//helper for recursive traversal
+};
+#endif
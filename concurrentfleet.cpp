@@ -0,0 +1,130 @@
+// UMBC - CMSC 341 - Spring 2025 - Proj2
+#include "concurrentfleet.h"
+#include <thread>
+
+// Constructor
+// Initializes an empty fleet of the given type, SPLAY lookups splay once every splaySample
+ConcurrentFleet::ConcurrentFleet(TREETYPE type, int splaySample) : m_fleet(type),
+                                 m_waitingWriters(0), m_splaySample(splaySample), m_lookups(0){
+}
+
+// Removes every ship
+void ConcurrentFleet::clear(){
+    unique_lock<shared_timed_mutex> writer = writeLock();
+    m_fleet.clear();
+}
+
+// Inserts a ship, see Fleet::insert
+void ConcurrentFleet::insert(const Ship& ship){
+    unique_lock<shared_timed_mutex> writer = writeLock();
+    m_fleet.insert(ship);
+}
+
+// Inserts n ships under a single lock, see Fleet::insertBatch
+void ConcurrentFleet::insertBatch(const Ship* ships, size_t n){
+    unique_lock<shared_timed_mutex> writer = writeLock();
+    m_fleet.insertBatch(ships, n);
+}
+
+// Removes a ship by ID, see Fleet::remove
+void ConcurrentFleet::remove(int id){
+    unique_lock<shared_timed_mutex> writer = writeLock();
+    m_fleet.remove(id);
+}
+
+// Removes the ships with n IDs under a single lock, see Fleet::removeBatch
+void ConcurrentFleet::removeBatch(const int* ids, size_t n){
+    unique_lock<shared_timed_mutex> writer = writeLock();
+    m_fleet.removeBatch(ids, n);
+}
+
+// Changes the tree type, see Fleet::setType
+void ConcurrentFleet::setType(TREETYPE type){
+    unique_lock<shared_timed_mutex> writer = writeLock();
+    m_fleet.setType(type);
+}
+
+// Returns the tree type
+TREETYPE ConcurrentFleet::getType() const{
+    shared_lock<shared_timed_mutex> reader = readLock();
+    return m_fleet.getType();
+}
+
+// Looks up a ship by ID. Runs in parallel with other lookups except for the
+// sampled SPLAY lookups, which splay the ship to the root under the writer lock
+bool ConcurrentFleet::find(int id, Ship& ship){
+    if (m_splaySample > 0 && getType() == SPLAY && m_lookups++ % m_splaySample == 0) {
+        unique_lock<shared_timed_mutex> writer = writeLock();
+        return m_fleet.find(id, ship);
+    }
+
+    shared_lock<shared_timed_mutex> reader = readLock();
+    return m_fleet.peek(id, ship);
+}
+
+// Returns true if a ship with the given ID is in the fleet
+bool ConcurrentFleet::contains(int id) const{
+    shared_lock<shared_timed_mutex> reader = readLock();
+    return m_fleet.contains(id);
+}
+
+// Copies the ship with the given ID into ship, never restructures the tree
+bool ConcurrentFleet::peek(int id, Ship& ship) const{
+    shared_lock<shared_timed_mutex> reader = readLock();
+    return m_fleet.peek(id, ship);
+}
+
+// Returns the number of ships
+int ConcurrentFleet::size() const{
+    shared_lock<shared_timed_mutex> reader = readLock();
+    return m_fleet.size();
+}
+
+// Returns the number of ships with an ID smaller than id
+int ConcurrentFleet::rank(int id) const{
+    shared_lock<shared_timed_mutex> reader = readLock();
+    return m_fleet.rank(id);
+}
+
+// Returns the number of ships with IDs in [lo, hi]
+int ConcurrentFleet::countInRange(int lo, int hi) const{
+    shared_lock<shared_timed_mutex> reader = readLock();
+    return m_fleet.countInRange(lo, hi);
+}
+
+// Returns the number of ships with the given type and state
+int ConcurrentFleet::count(SHIPTYPE type, STATE state) const{
+    shared_lock<shared_timed_mutex> reader = readLock();
+    return m_fleet.count(type, state);
+}
+
+// Returns a consistent version of the fleet that can be read without any lock
+// while writers go on. Taking it updates reference counts, so it is a writer
+Fleet ConcurrentFleet::snapshot() const{
+    unique_lock<shared_timed_mutex> writer = writeLock();
+    return m_fleet.snapshot();
+}
+
+// Empties a snapshot taken from this fleet under the writer lock, after which it
+// shares nothing and can be destroyed anywhere. Destroying a snapshot still sharing
+// nodes would change reference counts under the feet of a writer
+void ConcurrentFleet::release(Fleet& snapshot) const{
+    unique_lock<shared_timed_mutex> writer = writeLock();
+    snapshot.clear();
+}
+
+// Takes the reader lock once no writer is waiting. Readers only read the counter,
+// so they don't contend on anything but the shared lock itself
+shared_lock<shared_timed_mutex> ConcurrentFleet::readLock() const{
+    while (m_waitingWriters.load(memory_order_acquire) > 0)
+        this_thread::yield();
+    return shared_lock<shared_timed_mutex>(m_lock);
+}
+
+// Takes the writer lock, holding off new readers while the current ones finish
+unique_lock<shared_timed_mutex> ConcurrentFleet::writeLock() const{
+    m_waitingWriters.fetch_add(1, memory_order_acq_rel);
+    unique_lock<shared_timed_mutex> writer(m_lock);
+    m_waitingWriters.fetch_sub(1, memory_order_acq_rel);
+    return writer;
+}
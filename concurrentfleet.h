@@ -0,0 +1,66 @@
+// UMBC - CMSC 341 - Spring 2025 - Proj2
+#ifndef CONCURRENTFLEET_H
+#define CONCURRENTFLEET_H
+#include "fleet.h"
+#include <atomic>
+#include <mutex>
+#include <shared_mutex>
+
+// Thread-safe wrapper around a fleet. Lookups and queries share a reader lock and
+// run in parallel, changes take the lock exclusively and run one at a time.
+// A SPLAY lookup only restructures the tree once every splaySample lookups under
+// the exclusive lock; the others are plain reads, so readers don't become writers.
+// Writers waiting for the lock are counted and new readers yield until none is
+// left, so a steady stream of readers cannot starve a writer while readers still
+// take nothing but the shared lock. Snapshots can be read without any lock and are
+// given back through release().
+const int SPLAYSAMPLE = 16; // the default number of SPLAY lookups per splay
+
+class ConcurrentFleet{
+    public:
+    friend class Grader;
+    friend class Tester;
+    ConcurrentFleet(TREETYPE type, int splaySample = SPLAYSAMPLE);
+    ConcurrentFleet(const ConcurrentFleet&) = delete;
+    ConcurrentFleet& operator=(const ConcurrentFleet&) = delete;
+    void clear();
+    void insert(const Ship& ship);
+    void insertBatch(const Ship* ships, size_t n);
+    void remove(int id);
+    void removeBatch(const int* ids, size_t n);
+    void setType(TREETYPE type);
+    TREETYPE getType() const;
+    bool find(int id, Ship& ship);
+    bool contains(int id) const;
+    bool peek(int id, Ship& ship) const;
+    int size() const;
+    int rank(int id) const;
+    int countInRange(int lo, int hi) const;
+    int count(SHIPTYPE type, STATE state) const;
+    Fleet snapshot() const;
+    void release(Fleet& snapshot) const;
+    template <class Visitor>
+    void forEach(Visitor visit) const;
+    private:
+    Fleet m_fleet;                        // the wrapped fleet
+    mutable shared_timed_mutex m_lock;    // shared by readers, exclusive for writers
+    mutable atomic<int> m_waitingWriters; // writers waiting for m_lock, new readers yield to them
+    int m_splaySample;                    // SPLAY lookups per splay, 0 never splays
+    atomic<unsigned> m_lookups;           // the number of SPLAY lookups so far
+
+    // ***************************************************
+    // Any private helper functions must be declared here!
+    shared_lock<shared_timed_mutex> readLock() const;
+
+    unique_lock<shared_timed_mutex> writeLock() const;
+    // ***************************************************
+};
+
+// Calls visit on every ship in ID order under the reader lock
+template <class Visitor>
+void ConcurrentFleet::forEach(Visitor visit) const{
+    shared_lock<shared_timed_mutex> reader = readLock();
+    for (Fleet::const_iterator it = m_fleet.begin(); it != m_fleet.end(); ++it)
+        visit(*it);
+}
+#endif
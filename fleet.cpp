@@ -1,27 +1,54 @@
 // UMBC - CMSC 341 - Spring 2025 - Proj2
 #include "fleet.h"
+#include <algorithm>
+#include <fstream>
+#include <thread>
+#include <utility>
 
 // Default constructor
 // Initializes an empty fleet with no specific tree type
-Fleet::Fleet() : m_root(nullptr), m_type(NONE){
+Fleet::Fleet() : m_root(nullptr), m_type(NONE), m_pool(nullptr), m_path(nullptr), m_pathCapacity(0),
+                 m_present(nullptr), m_shipData(nullptr), m_denseSize(0), m_index(nullptr),
+                 m_aggregated(false), m_threads(1){
 }
 
 // Overloaded constructor
 // Initializes an empty fleet with the given tree type (BST/AVL/SPLAY)
-Fleet::Fleet(TREETYPE type) : m_root(nullptr), m_type(type){
+Fleet::Fleet(TREETYPE type) : m_root(nullptr), m_type(type), m_pool(nullptr), m_path(nullptr), m_pathCapacity(0),
+                              m_present(nullptr), m_shipData(nullptr), m_denseSize(0), m_index(nullptr),
+                              m_aggregated(false), m_threads(1){
 
 }
 
+// Copy constructor
+// Deep copies another fleet through the assignment operator
+Fleet::Fleet(const Fleet & rhs) : Fleet(){
+    *this = rhs;
+}
+
+// Move constructor
+// Takes over the nodes and buffers of another fleet in O(1) without allocating,
+// leaving it empty with no pool
+Fleet::Fleet(Fleet && rhs) noexcept : Fleet(){
+    swap(rhs);
+}
+
 // Destructor
 // Clears the tree to deallocate memory
 Fleet::~Fleet(){
     clear();
+    delete m_pool;
+    delete[] m_path;
+    delete m_index;
 }
 
 // Deallocates all memory associated with the current fleet tree
+// by releasing the node slabs in bulk, or only the unshared nodes if snapshots exist
 void Fleet::clear(){
-    clearHelper(m_root);
-    m_root = nullptr;
+    releaseTree();
+    releaseDense();
+    if (m_index != nullptr)
+        m_index->clear();
 }
 
 // Inserts a new Ship into the Fleet based on the type (BST, AVL, or SPLAY)
@@ -30,154 +57,367 @@ void Fleet::insert(const Ship& ship){
     if (m_type == NONE || ship.getID() < MINID || ship.getID() > MAXID)
         return;
 
-    Ship* temp = m_root;
-    Ship* prev = nullptr;
+    // DENSE sets the presence bit and stores type and state at the ID offset
+    if (m_type == DENSE) {
+        if (denseInsert(ship))
+            indexAdd(ship);
+        return;
+    }
 
-    // Locate the position for inserting
-    while (temp != nullptr) {
-        prev = temp;
+    // Locate the position for inserting, recording every link on the way down
+    Ship** link = &m_root;
+    int depth = 0;
+    while (unshare(link) != nullptr) {
         // No Duplicate IDs
-        if (temp->getID() == ship.getID())
+        if ((*link)->getID() == ship.getID())
             return;
 
-        else if (temp->getID() > ship.getID())
-            temp = temp->getLeft();
+        recordLink(depth++, link);
+        if ((*link)->getID() > ship.getID())
+            link = &(*link)->m_left;
 
         else
-            temp = temp->getRight();
+            link = &(*link)->m_right;
     }
 
     // Create and link the new Ship node
-    Ship* newShip = new Ship(ship.getID(), ship.getType(), ship.getState());
+    Ship* newShip = pool()->allocate(ship);
+    indexAdd(ship);
+    updateNode(newShip);
+    *link = newShip;
+    recordLink(depth, link);
 
-    if (prev == nullptr)
-        m_root = newShip;
+    if (m_type == SPLAY)
+        rotationSPLAY(depth); // Perform Splay operation (should splay new node to root)
 
-    else {
-        // Attach to left or right based on value
-        if (prev->getID() > ship.getID())
-            prev->setLeft(newShip);
-        else
-            prev->setRight(newShip);
+    else
+        retracePath(depth); // Update heights along the path, AVL also rebalances
+}
+
+// Orders ships by ID for sorting a batch
+static bool compareShipIDs(const Ship& a, const Ship& b){
+    return a.getID() < b.getID();
+}
+
+// Copies the ships with valid IDs of a batch into batch and sorts them by ID unless
+// they already are, stable so earlier ships stay first among duplicates. Returns the count
+static int copyBatch(const Ship* ships, size_t n, Ship* batch){
+    int count = 0;
+    bool sorted = true;
+    for (size_t i = 0; i < n; i++) {
+        int id = ships[i].getID();
+        if (id < MINID || id > MAXID)
+            continue;
+
+        if (count > 0 && batch[count - 1].getID() >= id)
+            sorted = false;
+        batch[count++] = Ship(id, ships[i].getType(), ships[i].getState());
+    }
+    if (!sorted)
+        stable_sort(batch, batch + count, compareShipIDs);
+    return count;
+}
+
+// Inserts n ships at once. The batch is sorted (skipped if already sorted),
+// merged with the ships already in the fleet and linked into a perfectly
+// balanced tree with heights set, O(n log n) or O(n) for sorted input.
+// Like insert, out of range IDs are skipped and existing or earlier ships win duplicates
+void Fleet::insertBatch(const Ship* ships, size_t n){
+    if (m_type == NONE || n == 0)
+        return;
+
+    if (m_type == DENSE) {
+        for (size_t i = 0; i < n; i++) {
+            if (ships[i].getID() >= MINID && ships[i].getID() <= MAXID && denseInsert(ships[i]))
+                indexAdd(ships[i]);
+        }
+        return;
+    }
+
+    // Copy the valid ships and sort them by ID unless they already are
+    Ship* batch = new Ship[n];
+    int count = copyBatch(ships, n, batch);
+
+    // Merge the existing nodes with new nodes for the batch in ID order
+    unshareAll(&m_root);
+    int existing = subtreeSize(m_root);
+    Ship** oldNodes = new Ship*[existing];
+    Ship** nodes = new Ship*[existing + count];
+    flattenTree(oldNodes);
+    pool()->reserve(count);
+
+    int i = 0;
+    int total = 0;
+    for (int j = 0; j < count; j++) {
+        int id = batch[j].getID();
+        if (j > 0 && batch[j - 1].getID() == id)
+            continue;
+
+        while (i < existing && oldNodes[i]->getID() < id)
+            nodes[total++] = oldNodes[i++];
+
+        if (i == existing || oldNodes[i]->getID() != id) {
+            nodes[total++] = m_pool->allocate(batch[j]);
+            indexAdd(batch[j]);
+        }
+    }
+    while (i < existing)
+        nodes[total++] = oldNodes[i++];
+
+    m_root = linkTree(nodes, 0, total - 1, m_threads);
+    delete[] nodes;
+    delete[] oldNodes;
+    delete[] batch;
+}
+
+// Inserts n ships sorted by ID in O(k log(n/k + 1)) for AVL: the batch is linked into
+// a balanced tree and merged in by the recursion of unionWith, which only touches the
+// tree where batch and fleet interleave. Unsorted batches are sorted first.
+// Like insert, out of range IDs are skipped and existing or earlier ships win duplicates
+void Fleet::mergeSortedBatch(const Ship* ships, size_t n){
+    if (m_type == NONE || n == 0)
+        return;
+
+    if (m_type == DENSE) {
+        insertBatch(ships, n);
+        return;
     }
 
-    // Update the heights of all the nodes and balance or splay the fleet based on tree type
-    updateHeights(m_root);
+    Ship* batch = new Ship[n];
+    int count = copyBatch(ships, n, batch);
 
-    if (m_type == AVL)
-        rotationAVL(); // Ensure AVL balancing
+    Ship** nodes = new Ship*[count];
+    pool()->reserve(count);
+    int total = 0;
+    for (int i = 0; i < count; i++) {
+        if (i == 0 || batch[i - 1].getID() != batch[i].getID())
+            nodes[total++] = m_pool->allocate(batch[i]);
+    }
 
-    else if (m_type == SPLAY)
-        rotationSPLAY(newShip); // Perform Splay operation (should splay new node to root)
+    limitHeight(&m_root);
+    mutex lock;
+    SetOperation operation = {KEEPLEFT, (m_threads > 1 && pool()->getUsers() == 1) ? &lock : nullptr};
+    m_root = unionTrees(m_root, linkTree(nodes, 0, total - 1, m_threads), operation, m_threads);
+    delete[] nodes;
+    delete[] batch;
 }
 
-// Deletes a ship by ID if BST or AVL; skips if SPLAY.
-// Re-balances if AVL
+// Deletes a ship by ID.
+// Re-balances if AVL, splays the ship to the root and joins its subtrees if SPLAY
 void Fleet::remove(int id){
-    // Skip deletion if fleet type is NONE or SPLAY or ID out of range or the m_root is nullptr
-    if(m_root != nullptr && m_type != NONE && m_type != SPLAY) {
-        if (id < MINID || id > MAXID)
+    // DENSE only clears the presence bit
+    if (m_type == DENSE && m_present != nullptr && id >= MINID && id <= MAXID) {
+        int offset = id - MINID;
+        uint64_t bit = uint64_t(1) << (offset % 64);
+        if ((m_present[offset / 64] & bit) != 0) {
+            Ship ship;
+            densePeek(id, ship);
+            indexRemove(ship);
+            m_present[offset / 64] &= ~bit;
+            m_denseSize--;
+        }
+        return;
+    }
+
+    // Skip deletion if fleet type is NONE or ID out of range or the m_root is nullptr
+    if (m_root == nullptr || m_type == NONE || id < MINID || id > MAXID)
+        return;
+
+    if (m_type == SPLAY) {
+        splay(&m_root, id);
+        if (m_root->getID() != id)
             return;
 
         Ship* temp = m_root;
-        Ship* prev = nullptr;
-
-        // Searches for the node to remove
-        while (temp != nullptr && temp->getID() != id) {
-            prev = temp;
+        m_root = splayJoin(temp->getLeft(), temp->getRight());
+        indexRemove(*temp);
+        m_pool->release(temp);
+        return;
+    }
 
-            if (temp->getID() > id)
-                temp = temp->getLeft();
+    // Searches for the node to remove, recording every link on the way down
+    Ship** link = &m_root;
+    int depth = 0;
+    while (unshare(link) != nullptr && (*link)->getID() != id) {
+        recordLink(depth++, link);
+        if ((*link)->getID() > id)
+            link = &(*link)->m_left;
 
-            else
-                temp = temp->getRight();
-        }
+        else
+            link = &(*link)->m_right;
+    }
 
-        if (temp != nullptr) {
-            // Case 1: Leaf node
-            if (temp->getLeft() == nullptr && temp->getRight() == nullptr) {
-                if (prev == nullptr)
-                    m_root = nullptr;
+    Ship* temp = *link;
+    if (temp == nullptr)
+        return;
 
-                else if (prev->getLeft() == temp)
-                    prev->setLeft(nullptr);
+    // Case 1 and 2: Leaf node or one child, the child takes its place
+    if (temp->getLeft() == nullptr || temp->getRight() == nullptr)
+        *link = (temp->getLeft() != nullptr) ? temp->getLeft() : temp->getRight();
 
-                else
-                    prev->setRight(nullptr);
+    // Case 3: Two children — replace using predecessor or successor
+    else {
+        int targetDepth = depth;
+        recordLink(depth++, link);
+        Ship** replacementLink;
+
+        // Decide replacement by comparing subtree heights
+        if (temp->getLeft()->getHeight() < temp->getRight()->getHeight()) {
+            // Use in-order predecessor (rightmost node of left subtree)
+            replacementLink = &temp->m_left;
+            while (unshare(replacementLink)->getRight() != nullptr) {
+                recordLink(depth++, replacementLink);
+                replacementLink = &(*replacementLink)->m_right;
             }
-            // Case 2: One child
-            else if (temp->getLeft() == nullptr || temp->getRight() == nullptr) {
-                Ship* child = (temp->getLeft() != nullptr) ? temp->getLeft() : temp->getRight();
-                if (prev == nullptr)
-                    m_root = child;
 
-                else if (prev->getLeft() == temp)
-                    prev->setLeft(child);
+            Ship* replacement = *replacementLink;
+            *replacementLink = replacement->getLeft();
+            replacement->setLeft(temp->getLeft());
+            replacement->setRight(temp->getRight());
+            *link = replacement;
 
-                else
-                    prev->setRight(child);
+            // The link below the target now lives in the replacement
+            if (depth > targetDepth + 1)
+                m_path[targetDepth + 1] = &replacement->m_left;
+        }
+        else {
+            // Use in-order successor (leftmost node of right subtree)
+            replacementLink = &temp->m_right;
+            while (unshare(replacementLink)->getLeft() != nullptr) {
+                recordLink(depth++, replacementLink);
+                replacementLink = &(*replacementLink)->m_left;
             }
 
-            // Case 3: Two children — replace using predecessor or successor
-            else {
-                Ship* replacement;
-                Ship* replacementParent = temp;
-
-                // Decide replacement by comparing subtree heights
-                if (temp->getLeft()->getHeight() < temp->getRight()->getHeight()) {
-                    // Use in-order predecessor (rightmost node of left subtree)
-                    replacement = temp->getLeft();
-                    while (replacement->getRight() != nullptr) {
-                        replacementParent = replacement;
-                        replacement = replacement->getRight();
-                    }
-
-                    // If predecessor is not the direct left child
-                    if (replacementParent != temp) {
-                        replacementParent->setRight(replacement->getLeft());
-                        replacement->setLeft(temp->getLeft());
-                    }
-
-                    replacement->setRight(temp->getRight());
-                }
-                else{
-                    // Use in-order successor (leftmost node of right subtree)
-                    replacement = temp->getRight();
-                    while (replacement->getLeft() != nullptr) {
-                        replacementParent = replacement;
-                        replacement = replacement->getLeft();
-                    }
-
-                    // If successor is not the direct right child
-                    if (replacementParent != temp) {
-                        replacementParent->setLeft(replacement->getRight());
-                        replacement->setRight(temp->getRight());
-                    }
-
-                    replacement->setLeft(temp->getLeft());
-                }
+            Ship* replacement = *replacementLink;
+            *replacementLink = replacement->getRight();
+            replacement->setRight(temp->getRight());
+            replacement->setLeft(temp->getLeft());
+            *link = replacement;
 
-                if (prev == nullptr)
-                    m_root = replacement;
+            // The link below the target now lives in the replacement
+            if (depth > targetDepth + 1)
+                m_path[targetDepth + 1] = &replacement->m_right;
+        }
+    }
 
-                else if (prev->getLeft() == temp)
-                    prev->setLeft(replacement);
+    indexRemove(*temp);
+    m_pool->release(temp);
 
-                else
-                    prev->setRight(replacement);
-            }
+    // Update heights along the path, AVL also rebalances
+    retracePath(depth);
+}
 
-            temp->setLeft(nullptr);
-            temp->setRight(nullptr);
-            delete temp;
+// Deletes every ship with an ID in [lo, hi] in O(log n + k) for AVL: the range is
+// split out of the tree, released in one walk and the rest joined back once
+void Fleet::removeRange(int lo, int hi){
+    if (m_type == NONE || lo > hi)
+        return;
 
-        // Balance the tree if AVL and update heights if BST/AVL
-            updateHeights(m_root);
-            if (m_type == AVL)
-                rotationAVL(); // Ensure AVL balancing
+    if (m_type == DENSE) {
+        int first = (lo > MINID) ? lo - MINID : 0;
+        for (int offset = nextDense(first); offset < IDCOUNT && offset + MINID <= hi; offset = nextDense(offset + 1))
+            remove(offset + MINID);
+        return;
+    }
 
-        }
+    if (m_root == nullptr)
+        return;
+
+    limitHeight(&m_root);
+    Ship* less;
+    Ship* first;
+    Ship* rest;
+    Ship* middle;
+    Ship* last;
+    Ship* greater;
+    splitTree(m_root, lo, less, first, rest);
+    splitTree(rest, hi, middle, last, greater);
+
+    SetOperation operation = {KEEPLEFT, nullptr};
+    discardTree(first, true, operation);
+    discardTree(middle, true, operation);
+    discardTree(last, true, operation);
+    m_root = join2(less, greater);
+}
+
+// Deletes the ships with n IDs at once. The IDs are sorted (skipped if already sorted),
+// then the tree is split around the middle ID and both halves are processed the same
+// way and joined back, so the tree is rebalanced along the joins only: O(k log(n/k + 1))
+// for AVL, on m_threads threads unless snapshots share the pool. Absent IDs are skipped
+void Fleet::removeBatch(const int* ids, size_t n){
+    if (m_type == NONE || n == 0)
+        return;
+
+    if (m_type == DENSE) {
+        for (size_t i = 0; i < n; i++)
+            remove(ids[i]);
+        return;
+    }
+
+    if (m_root == nullptr)
+        return;
+
+    int* batch = new int[n];
+    int count = 0;
+    bool sorted = true;
+    for (size_t i = 0; i < n; i++) {
+        if (ids[i] < MINID || ids[i] > MAXID)
+            continue;
+
+        if (count > 0 && batch[count - 1] >= ids[i])
+            sorted = false;
+        batch[count++] = ids[i];
+    }
+    if (!sorted) {
+        sort(batch, batch + count);
+        count = unique(batch, batch + count) - batch;
+    }
+
+    limitHeight(&m_root);
+    mutex lock;
+    SetOperation operation = {KEEPLEFT, (m_threads > 1 && pool()->getUsers() == 1) ? &lock : nullptr};
+    m_root = removeSorted(m_root, batch, count, operation, m_threads);
+    delete[] batch;
+}
+
+// Looks up a ship by ID and copies it into ship, returns false if not found.
+// In a SPLAY fleet the accessed node (or the last node visited) is splayed to the root
+bool Fleet::find(int id, Ship& ship){
+    if (m_type != SPLAY)
+        return peek(id, ship);
+
+    if (m_root == nullptr || id < MINID || id > MAXID)
+        return false;
+
+    splay(&m_root, id);
+    if (m_root->getID() != id)
+        return false;
+
+    ship = Ship(m_root->getID(), m_root->getType(), m_root->getState());
+    return true;
+}
+
+// Returns true if a ship with the given ID is in the fleet, never restructures the tree
+bool Fleet::contains(int id) const{
+    if (m_type == DENSE) {
+        Ship ship;
+        return densePeek(id, ship);
     }
+    return findNode(id) != nullptr;
+}
+
+// Copies the ship with the given ID into ship without restructuring the tree,
+// returns false if not found
+bool Fleet::peek(int id, Ship& ship) const{
+    if (m_type == DENSE)
+        return densePeek(id, ship);
+
+    Ship* node = findNode(id);
+    if (node == nullptr)
+        return false;
+
+    ship = Ship(node->getID(), node->getType(), node->getState());
+    return true;
 }
 
 // Overloaded Assignment Operator
@@ -187,278 +427,2151 @@ const Fleet & Fleet::operator=(const Fleet & rhs){
         // Deallocate existing memory
         clear();
         m_type = rhs.m_type;
+        m_threads = rhs.m_threads;
 
         Ship* temp = rhs.m_root;
 
-        if (temp != nullptr)
-            // Deep copy the tree
-            m_root = assignmentOperatorHelper(temp);
+        if (rhs.m_present != nullptr)
+            copyDense(rhs);
+
+        // Deep copy the tree into one contiguous slab
+        m_root = assignmentOperatorHelper(temp);
+
+        // The copy is indexed like the original
+        setIndexed(false);
+        setIndexed(rhs.m_index != nullptr);
+        setAggregated(false);
+        setAggregated(rhs.m_aggregated);
+    }
+    return *this;
+}
+
+// Move assignment operator
+// Takes over the contents of rhs in O(1), the old contents are released and rhs is left empty
+const Fleet & Fleet::operator=(Fleet && rhs) noexcept{
+    if (this != &rhs) {
+        Fleet old(std::move(rhs));
+        swap(old);
     }
-    updateHeights(m_root);
-    dumpTree();
     return *this;
 }
 
+// Exchanges the contents of two fleets in O(1)
+void Fleet::swap(Fleet & other) noexcept{
+    std::swap(m_root, other.m_root);
+    std::swap(m_type, other.m_type);
+    std::swap(m_pool, other.m_pool);
+    std::swap(m_path, other.m_path);
+    std::swap(m_pathCapacity, other.m_pathCapacity);
+    std::swap(m_present, other.m_present);
+    std::swap(m_shipData, other.m_shipData);
+    std::swap(m_denseSize, other.m_denseSize);
+    std::swap(m_index, other.m_index);
+    std::swap(m_aggregated, other.m_aggregated);
+    std::swap(m_threads, other.m_threads);
+}
+
+// Returns a version of the fleet as it is now in O(1). The version shares every node
+// with this fleet; later changes to either copy only the nodes on the paths they
+// touch, so neither ever sees the other's changes. The index and aggregates are
+// not carried over and a DENSE fleet copies its fixed-size bitmap.
+// Versions may be read from other threads while one of them is being changed, but
+// changing, taking and destroying versions of one fleet must happen one at a time
+Fleet Fleet::snapshot() const{
+    Fleet version(m_type);
+    version.m_threads = m_threads;
+    if (m_present != nullptr)
+        version.copyDense(*this);
+
+    version.m_pool = m_pool;
+    if (m_pool != nullptr)
+        m_pool->addUser();
+    version.m_root = m_root;
+    if (m_root != nullptr)
+        m_root->m_refs++;
+
+    return version;
+}
+
 // Returns current tree type
 TREETYPE Fleet::getType() const{
     return m_type;
 }
 
-// Changes tree type and re-balances if necessary
+// Changes tree type and re-balances in linear time if necessary.
+// Converting to or from DENSE moves every ship in linear time
 void Fleet::setType(TREETYPE type){
     if (type == NONE) {
         m_type = type;
         clear(); // Clear the tree if the type is set to NONE
     }
 
+    else if (type == DENSE) {
+        if (m_type != DENSE)
+            treeToDense();
+        m_type = type;
+    }
+
+    else if (m_type == DENSE) {
+        // The rebuilt tree is perfectly balanced, valid for every tree type
+        denseToTree();
+        m_type = type;
+    }
+
     else if (type == AVL) {
+        if (m_type != AVL)
+            rebuildBalanced(&m_root);
         m_type = type;
-        rotationAVL();
     }
 
     else
      m_type = type;
 }
 
-// Detects for an imbalance in AVL tree by checking balance factor
-Ship* Fleet::imbalance(Ship *node) {
-    if (node == nullptr)
-        return nullptr;
+// Updates heights of all nodes of a subtree in post-order.
+// Uses the path buffer as an explicit stack so degenerate trees are safe
+void Fleet::updateHeights(Ship *node){
+    Ship* top = node;
+    Ship* empty = nullptr;
+    Ship* last = nullptr;
+    Ship** link = &top;
+    int depth = 0;
+    while (*link != nullptr || depth > 0) {
+        // Go down the left spine
+        while (*link != nullptr) {
+            recordLink(depth++, link);
+            link = &(*link)->m_left;
+        }
 
-    // Calculate the balance factor
-    int balanceFactor = (node->getLeft() != nullptr ? node->getLeft()->getHeight() : -1) -
-                        (node->getRight() != nullptr ? node->getRight()->getHeight() : -1);
+        // Visit the right subtree first, then the node itself
+        Ship* current = *m_path[depth - 1];
+        if (current->getRight() != nullptr && current->getRight() != last)
+            link = &current->m_right;
 
-    // If this node is unbalanced, return it
-    if (abs(balanceFactor) > 1)
-        return node;
+        else {
+            updateNode(current);
+            last = current;
+            depth--;
+            link = &empty;
+        }
+    }
+}
 
-    // Check left and right subtrees for imbalance
-    Ship* leftImbalance = imbalance(node->getLeft());
-    if (leftImbalance != nullptr)
-        return leftImbalance;
+// Rebuilds the tree held by link into a complete, and therefore AVL balanced, tree
+// in linear time without allocating (Day-Stout-Warren): the tree is flattened into a
+// sorted right vine by right rotations, then compressed by left rotations
+void Fleet::rebuildBalanced(Ship** link) {
+    unshareAll(link);
+    Ship pseudoRoot;
+    pseudoRoot.setRight(*link);
 
-    Ship* rightImbalance = imbalance(node->getRight());
-    if (rightImbalance != nullptr)
-        return rightImbalance;
+    int size = treeToVine(&pseudoRoot);
 
-    return nullptr;
-}
+    // The first pass leaves the bottom level only partly filled
+    int fullSize = 1;
+    while (fullSize * 2 + 1 <= size)
+        fullSize = fullSize * 2 + 1;
 
-// Recursively updates heights of all nodes
-void Fleet::updateHeights(Ship *node){
-    if (node != nullptr) {
+    compress(&pseudoRoot, size - fullSize);
+    for (size = fullSize; size > 1; size /= 2)
+        compress(&pseudoRoot, size / 2);
+
+    *link = pseudoRoot.getRight();
+    updateHeights(*link);
+}
 
-        updateHeights(node->getLeft());
-        updateHeights(node->getRight());
+// Rebuilds the BST or SPLAY tree held by link if it is too deep for the recursive
+// join and split helpers. AVL trees never are
+void Fleet::limitHeight(Ship** link) {
+    int limit = 8;
+    for (int count = subtreeSize(*link); count > 0; count /= 2)
+        limit += 3;
 
-        int leftHeight = (node->getLeft() != nullptr ? node->getLeft()->getHeight() : -1);
-        int rightHeight = (node->getRight() != nullptr ? node->getRight()->getHeight() : -1);
+    if (height(*link) > limit)
+        rebuildBalanced(link);
+}
 
-        node->setHeight((leftHeight > rightHeight ? leftHeight : rightHeight) + 1);
+// Turns the tree below pseudoRoot into a vine of right children in ID order
+// and returns the number of nodes
+int Fleet::treeToVine(Ship* pseudoRoot) {
+    int size = 0;
+    Ship* tail = pseudoRoot;
+    Ship* rest = tail->getRight();
+    while (rest != nullptr) {
+        if (rest->getLeft() == nullptr) {
+            tail = rest;
+            rest = rest->getRight();
+            size++;
+        }
+        else {
+            // Right rotation, the left child moves up into the vine
+            Ship* leftChild = rest->getLeft();
+            rest->setLeft(leftChild->getRight());
+            leftChild->setRight(rest);
+            rest = leftChild;
+            tail->setRight(leftChild);
+        }
     }
+    return size;
 }
 
-// Recursive helper to delete all nodes
-void Fleet::clearHelper(Ship *root) {
-    if (root != nullptr) {
-        clearHelper(root->getLeft());
-        clearHelper(root->getRight());
-        delete root;
+// Performs count left rotations down the right spine below pseudoRoot,
+// lifting every second node of the vine
+void Fleet::compress(Ship* pseudoRoot, int count) {
+    Ship* scanner = pseudoRoot;
+    for (int i = 0; i < count; i++) {
+        Ship* child = scanner->getRight();
+        scanner->setRight(child->getRight());
+        scanner = scanner->getRight();
+        child->setRight(scanner->getLeft());
+        scanner->setLeft(child);
     }
 }
 
-// Performs AVL rotations (LL, RR, LR, RL) until balanced
-void Fleet::rotationAVL() {
-    do {
-        Ship* node = imbalance(m_root);
-        if (node == nullptr)
-            return;
+// Performs Splay operations to bring the node linked at the given depth of the
+// recorded path to the root, updating heights of the touched nodes only
+void Fleet::rotationSPLAY(int depth) {
+    while (depth > 0) {
+        Ship* shipNode = *m_path[depth];
+        Ship* parent = *m_path[depth - 1];
 
-        int balanceFactor = (node->getLeft() != nullptr ? node->getLeft()->getHeight() : -1) -
-                            (node->getRight() != nullptr ? node->getRight()->getHeight() : -1);
+        // Zig Case (Single Rotation)
+        if (depth == 1) {
+            if (shipNode == parent->getLeft())
+                *m_path[0] = rotateRight(parent); // Right Rotation (Zig)
 
-        Ship* parent = nullptr;
-        Ship* current = m_root;
-        while (current != nullptr && current != node) {
-            parent = current;
-            current = (node->getID() < current->getID()) ? current->getLeft() : current->getRight();
+            else
+                *m_path[0] = rotateLeft(parent); // Left Rotation (Zag)
+
+            depth = 0;
+        }
+        // Zig-Zig or Zig-Zag or Zag-Zig or Zag-Zag Case
+        else {
+            Ship* grandParent = *m_path[depth - 2];
+            if (parent == grandParent->getLeft()) {
+                if (shipNode == parent->getLeft()) {
+                    // Zig-Zig (Right-Right Rotation)
+                    parent = rotateRight(grandParent);
+                    *m_path[depth - 2] = rotateRight(parent);
+                }
+                else {
+                    // Zig-Zag (Right-Left Rotation)
+                    grandParent->setLeft(rotateLeft(parent));
+                    *m_path[depth - 2] = rotateRight(grandParent);
+                }
+            }
+            else {
+                if (shipNode == parent->getRight()) {
+                    // Zag-Zag (Left-Left Rotation)
+                    parent = rotateLeft(grandParent);
+                    *m_path[depth - 2] = rotateLeft(parent);
+                }
+                else {
+                    // Zag-Zig (Left-Right Rotation)
+                    grandParent->setRight(rotateRight(parent));
+                    *m_path[depth - 2] = rotateLeft(grandParent);
+                }
+            }
+            depth -= 2;
         }
+    }
+}
 
-        // Left Heavy
-        if (balanceFactor > 1) {
-            Ship* leftChild = node->getLeft();
+// Splays the node with the given ID, or the last node visited when searching
+// for it, to the root of the subtree held by rootLink
+void Fleet::splay(Ship** rootLink, int id) {
+    if (*rootLink == nullptr)
+        return;
 
-            if (leftChild != nullptr && leftChild->getRight() != nullptr &&
-                leftChild->getRight()->getHeight() >
-                ((leftChild->getLeft() != nullptr) ? leftChild->getLeft()->getHeight() : -1)) {
-                // Left-Right Rotation
-                Ship* leftRightChild = leftChild->getRight();
-                leftChild->setRight(leftRightChild->getLeft());
-                leftRightChild->setLeft(leftChild);
-                node->setLeft(leftRightChild);
-            }
+    // Searches for the ship, recording every link on the way down
+    Ship** link = rootLink;
+    int depth = 0;
+    recordLink(depth, link);
+    while (unshare(link)->getID() != id) {
+        Ship** next = ((*link)->getID() > id) ? &(*link)->m_left : &(*link)->m_right;
+        if (*next == nullptr)
+            break;
+
+        link = next;
+        recordLink(++depth, link);
+    }
 
-            // Left-Left Rotation
-            Ship* leftChildNow = node->getLeft();
-            node->setLeft(leftChildNow->getRight());
-            leftChildNow->setRight(node);
+    rotationSPLAY(depth);
+}
 
-            if (parent == nullptr)
-                m_root = leftChildNow;
+// Joins two splay subtrees where every ID in left is smaller than every ID in right
+// by splaying the maximum of left to its root, returns the joined subtree
+Ship* Fleet::splayJoin(Ship* left, Ship* right) {
+    if (left == nullptr)
+        return right;
 
-            else if (parent->getLeft() == node)
-                parent->setLeft(leftChildNow);
+    splay(&left, MAXID + 1);
+    left->setRight(right);
+    updateNode(left);
+    return left;
+}
 
-            else
-                parent->setRight(leftChildNow);
-        }
-        // Right Heavy
-        else if (balanceFactor < -1) {
-            Ship* rightChild = node->getRight();
-            if (rightChild != nullptr && rightChild->getLeft() != nullptr &&
-                rightChild->getLeft()->getHeight() >
-                ((rightChild->getRight() != nullptr) ? rightChild->getRight()->getHeight() : -1)) {
-                // Right-Left Rotation
-                Ship* rightLeftChild = rightChild->getLeft();
-                rightChild->setLeft(rightLeftChild->getRight());
-                rightLeftChild->setRight(rightChild);
-                node->setRight(rightLeftChild);
-            }
+// Returns the height of a subtree, -1 for an empty subtree
+int Fleet::height(Ship* node) const {
+    return (node != nullptr) ? node->getHeight() : -1;
+}
 
-            // Right-Right Rotation
-            Ship* rightChildNow = node->getRight();
-            node->setRight(rightChildNow->getLeft());
-            rightChildNow->setLeft(node);
+// Returns the number of nodes of a subtree, 0 for an empty subtree
+int Fleet::subtreeSize(Ship* node) const {
+    return (node != nullptr) ? node->getSize() : 0;
+}
 
-            if (parent == nullptr)
-                m_root = rightChildNow;
+// Recomputes the height and subtree size of a single node from its children
+void Fleet::updateNode(Ship* node) {
+    int leftHeight = height(node->getLeft());
+    int rightHeight = height(node->getRight());
+    node->setHeight((leftHeight > rightHeight ? leftHeight : rightHeight) + 1);
+    node->setSize(subtreeSize(node->getLeft()) + subtreeSize(node->getRight()) + 1);
+    if (m_aggregated)
+        updateAggregate(node);
+}
 
-            else if (parent->getLeft() == node)
-                parent->setLeft(rightChildNow);
+// Rotates a subtree to the left and returns its new root
+Ship* Fleet::rotateLeft(Ship* node) {
+    Ship* rightChild = unshare(&node->m_right);
+    node->setRight(rightChild->getLeft());
+    rightChild->setLeft(node);
+    updateNode(node);
+    updateNode(rightChild);
+    return rightChild;
+}
 
-            else
-                parent->setRight(rightChildNow);
-        }
-        updateHeights(m_root);
+// Rotates a subtree to the right and returns its new root
+Ship* Fleet::rotateRight(Ship* node) {
+    Ship* leftChild = unshare(&node->m_left);
+    node->setLeft(leftChild->getRight());
+    leftChild->setRight(node);
+    updateNode(node);
+    updateNode(leftChild);
+    return leftChild;
+}
 
-    } while (imbalance(m_root) != nullptr);
+// Restores the AVL property at a node whose children are balanced (LL, RR, LR, RL)
+// and returns the new root of the subtree
+Ship* Fleet::rebalance(Ship* node) {
+    updateNode(node);
+    int balanceFactor = height(node->getLeft()) - height(node->getRight());
+
+    // Left Heavy
+    if (balanceFactor > 1) {
+        // Left-Right Rotation
+        if (height(node->getLeft()->getLeft()) < height(node->getLeft()->getRight()))
+            node->setLeft(rotateLeft(unshare(&node->m_left)));
+
+        // Left-Left Rotation
+        return rotateRight(node);
+    }
+    // Right Heavy
+    if (balanceFactor < -1) {
+        // Right-Left Rotation
+        if (height(node->getRight()->getRight()) < height(node->getRight()->getLeft()))
+            node->setRight(rotateRight(unshare(&node->m_right)));
+
+        // Right-Right Rotation
+        return rotateLeft(node);
+    }
+    return node;
 }
 
-// Performs Splay operations to bring the accessed node to the root
-void Fleet::rotationSPLAY(Ship* shipNode) {
-    if (shipNode != nullptr && m_root != shipNode) {
-            while (m_root != shipNode) {
-                Ship* greatGrandParent = nullptr;
-                Ship* grandParent = nullptr;
-                Ship* parent = nullptr;
-                Ship* child = m_root;
+// Stores a link at the given depth of the path buffer, growing it if needed
+void Fleet::recordLink(int depth, Ship** link) {
+    if (depth >= m_pathCapacity) {
+        int capacity = (m_pathCapacity > 0) ? m_pathCapacity * 2 : 64;
+        Ship*** path = new Ship**[capacity];
+        for (int i = 0; i < depth; i++)
+            path[i] = m_path[i];
+
+        delete[] m_path;
+        m_path = path;
+        m_pathCapacity = capacity;
+    }
+    m_path[depth] = link;
+}
 
-                // Find the parent and grandparent of insertedShip
-                while (child != shipNode) {
-                    greatGrandParent = grandParent;
-                    grandParent = parent;
-                    parent = child;
-                    child = (shipNode->getID() < child->getID()) ? child->getLeft() : child->getRight();
-                }
+// Walks the recorded path bottom-up from the given depth, fixing heights of the
+// nodes whose subtrees changed and rebalancing them if the fleet is AVL
+void Fleet::retracePath(int depth) {
+    for (int i = depth - 1; i >= 0; i--) {
+        Ship** link = m_path[i];
+        if (m_type == AVL)
+            *link = rebalance(*link);
 
-                // Zig Case (Single Rotation)
-                if (parent == m_root) {
-                    if (shipNode == parent->getLeft()) {
-                        // Right Rotation (Zig)
-                        parent->setLeft(shipNode->getRight());
-                        shipNode->setRight(parent);
-                    }
-
-                    else {
-                        // Left Rotation (Zag)
-                        parent->setRight(shipNode->getLeft());
-                        shipNode->setLeft(parent);
-                    }
-                    m_root = shipNode;
-                }
-                // Zig-Zig or Zig-Zag or Zag-Zig or Zag-Zag Case
-                else {
-                    if (parent == grandParent->getLeft()) {
-                        if (shipNode == parent->getLeft()) {
-                            // Zig-Zig (Right-Right Rotation)
-                            grandParent->setLeft(parent->getRight());
-                            parent->setRight(grandParent);
-                            parent->setLeft(shipNode->getRight());
-                            shipNode->setRight(parent);
-                        }
-                        else {
-                            // Zig-Zag (Right-Left Rotation)
-                            parent->setRight(shipNode->getLeft());
-                            grandParent->setLeft(shipNode->getRight());
-                            shipNode->setLeft(parent);
-                            shipNode->setRight(grandParent);
-                        }
-                    }
-                    else {
-                        if (shipNode == parent->getRight()) {
-                            // Zag-Zag (Left-Left Rotation)
-                            grandParent->setRight(parent->getLeft());
-                            parent->setLeft(grandParent);
-                            parent->setRight(shipNode->getLeft());
-                            shipNode->setLeft(parent);
-                        }
-                        else {
-                            // Zag-Zig (Left-Right Rotation)
-                            parent->setLeft(shipNode->getRight());
-                            grandParent->setRight(shipNode->getLeft());
-                            shipNode->setRight(parent);
-                            shipNode->setLeft(grandParent);
-                        }
-                    }
-
-                    // Update greatGrandParent's child pointer
-                    if (greatGrandParent != nullptr) {
-                        if (grandParent == greatGrandParent->getLeft())
-                            greatGrandParent->setLeft(shipNode);
-
-                        else
-                            greatGrandParent->setRight(shipNode);
-
-                    }
-                    else
-                        // Update the root if grandParent was the root
-                        m_root = shipNode;
-                }
-            }
-            updateHeights(m_root);
+        else
+            updateNode(*link);
     }
 }
 
-// Recursively copies a tree for assignment operator
+// Returns the node with the given ID or nullptr, read-only search
+Ship* Fleet::findNode(int id) const {
+    Ship* temp = m_root;
+    while (temp != nullptr && temp->getID() != id)
+        temp = (temp->getID() > id) ? temp->getLeft() : temp->getRight();
+
+    return temp;
+}
+
+// Copies a tree with its heights for assignment operator into one contiguous block
+// of nodes, in parallel on up to m_threads threads for large trees
 Ship* Fleet::assignmentOperatorHelper(Ship* otherNode) {
-    if (otherNode != nullptr) {
-        int shipID = otherNode->getID();
-        SHIPTYPE shipType = otherNode->getType();
-        STATE shipState = otherNode->getState();
+    if (otherNode == nullptr)
+        return nullptr;
 
-        Ship *newShip = new Ship(shipID, shipType, shipState);
+    Ship* block = pool()->allocateBlock(otherNode->getSize());
+    copyTree(otherNode, block, m_threads);
+    return block;
+}
 
-        newShip->setLeft(assignmentOperatorHelper(otherNode->getLeft()));
-        newShip->setRight(assignmentOperatorHelper(otherNode->getRight()));
+// Copies the subtree of source into block in pre-order: the root first, then its
+// left subtree and its right subtree, so subtree sizes give every node's slot and
+// threads can fill disjoint parts of the block. Below the top levels the copy
+// walks with an explicit stack no deeper than the height
+void Fleet::copyTree(Ship* source, Ship* block, int threads) {
+    if (threads > 1 && source->getSize() >= PARALLELCUTOFF) {
+        copyNode(source, block);
+        Ship* left = source->getLeft();
+        Ship* right = source->getRight();
+        thread worker;
+        if (left != nullptr)
+            worker = thread(&Fleet::copyTree, this, left, block + 1, threads / 2);
+        if (right != nullptr)
+            copyTree(right, block + 1 + subtreeSize(left), threads - threads / 2);
+        if (worker.joinable())
+            worker.join();
+        return;
+    }
 
-        return newShip;
+    struct CopyStep{
+        Ship* m_source; // a node of the other tree
+        Ship* m_copy;   // the slot of its copy
+    };
+    CopyStep* stack = new CopyStep[source->getHeight() + 2];
+    int depth = 0;
+    stack[depth++] = {source, block};
+
+    while (depth > 0) {
+        CopyStep step = stack[--depth];
+        copyNode(step.m_source, step.m_copy);
+        if (step.m_source->getRight() != nullptr)
+            stack[depth++] = {step.m_source->getRight(), step.m_copy->getRight()};
+        if (step.m_source->getLeft() != nullptr)
+            stack[depth++] = {step.m_source->getLeft(), step.m_copy->getLeft()};
     }
+    delete[] stack;
+}
 
-    return nullptr;
+// Copies one node into its pre-order slot and points it at the slots of its children
+void Fleet::copyNode(Ship* source, Ship* copy) {
+    copy->reset(*source);
+    copy->setHeight(source->getHeight());
+    copy->setSize(source->getSize());
+    if (source->getLeft() != nullptr)
+        copy->setLeft(copy + 1);
+    if (source->getRight() != nullptr)
+        copy->setRight(copy + 1 + subtreeSize(source->getLeft()));
 }
 
 void Fleet::dumpTree() const
 {
-    dump(m_root);
+    if (m_type == DENSE)
+        dumpDense();
+
+    else
+        dump(m_root);
 }
 
 void Fleet::dump(Ship* aShip) const{
-    if (aShip != nullptr){
-        cout << "(";
-        dump(aShip->m_left);//first visit the left child
-        cout << aShip->m_id << ":" << aShip->m_height;//second visit the node itself
-        dump(aShip->m_right);//third visit the right child
-        cout << ")";
-    }
-}
\ No newline at end of file
+    if (aShip == nullptr)
+        return;
+
+    // Nodes stay on the stack until their right subtree is printed
+    Ship** stack = new Ship*[aShip->getHeight() + 1];
+    int depth = 0;
+    Ship* last = nullptr;
+    while (aShip != nullptr || depth > 0) {
+        while (aShip != nullptr) {
+            cout << "(";
+            stack[depth++] = aShip;
+            aShip = aShip->m_left;//first visit the left child
+        }
+
+        Ship* current = stack[depth - 1];
+        if (current->m_right != nullptr && current->m_right == last) {
+            cout << ")";
+            last = current;
+            depth--;
+        }
+        else {
+            cout << current->m_id << ":" << current->m_height;//second visit the node itself
+            if (current->m_right != nullptr)
+                aShip = current->m_right;//third visit the right child
+
+            else {
+                cout << ")";
+                last = current;
+                depth--;
+            }
+        }
+    }
+    delete[] stack;
+}
+
+// Links nodes[first..last], which must be sorted by ID without duplicates,
+// into a perfectly balanced subtree and returns its root with heights set.
+// Large ranges split their halves between up to threads threads
+Ship* Fleet::linkTree(Ship** nodes, int first, int last, int threads) {
+    if (first > last)
+        return nullptr;
+
+    int middle = first + (last - first) / 2;
+    Ship* node = nodes[middle];
+    if (threads > 1 && last - first + 1 >= PARALLELCUTOFF) {
+        Ship* left = nullptr;
+        thread worker([&]() {left = linkTree(nodes, first, middle - 1, threads / 2);});
+        node->setRight(linkTree(nodes, middle + 1, last, threads - threads / 2));
+        worker.join();
+        node->setLeft(left);
+    }
+    else {
+        node->setLeft(linkTree(nodes, first, middle - 1));
+        node->setRight(linkTree(nodes, middle + 1, last));
+    }
+    updateNode(node);
+    return node;
+}
+
+// Writes the nodes of the tree to nodes in ID order and returns their number.
+// Uses the path buffer as an explicit stack so degenerate trees are safe
+int Fleet::flattenTree(Ship** nodes) {
+    int count = 0;
+    int depth = 0;
+    Ship** link = &m_root;
+    while (*link != nullptr || depth > 0) {
+        // Go down the left spine, then visit the deepest node and turn right
+        while (*link != nullptr) {
+            recordLink(depth++, link);
+            link = &(*link)->m_left;
+        }
+        Ship* node = *m_path[--depth];
+        nodes[count++] = node;
+        link = &node->m_right;
+    }
+    return count;
+}
+
+// Makes sure the node held by link belongs to this fleet version alone and returns it.
+// A node shared with other versions is replaced by a copy whose children become
+// shared instead, so copying along a path from the root costs one node per level
+Ship* Fleet::unshare(Ship** link) {
+    Ship* node = *link;
+    if (node == nullptr || node->m_refs == 1)
+        return node;
+
+    Ship* copy = m_pool->allocate(*node);
+    copy->setLeft(node->getLeft());
+    copy->setRight(node->getRight());
+    copy->setHeight(node->getHeight());
+    copy->setSize(node->getSize());
+    for (int i = 0; m_aggregated && i < SHIPCLASSES; i++)
+        copy->m_counts[i] = node->m_counts[i];
+    if (copy->getLeft() != nullptr)
+        copy->getLeft()->m_refs++;
+    if (copy->getRight() != nullptr)
+        copy->getRight()->m_refs++;
+
+    node->m_refs--;
+    *link = copy;
+    return copy;
+}
+
+// Copies every node of the tree held by link that this fleet shares with other
+// versions, in linear time. Needed before operations that relink the whole tree
+void Fleet::unshareAll(Ship** link) {
+    if (m_pool == nullptr || m_pool->getUsers() == 1)
+        return;
+
+    int depth = 0;
+    recordLink(depth++, link);
+    while (depth > 0) {
+        Ship* node = unshare(m_path[--depth]);
+        if (node != nullptr) {
+            recordLink(depth++, &node->m_left);
+            recordLink(depth++, &node->m_right);
+        }
+    }
+}
+
+// Releases the tree. A pool used by this fleet alone is cleared in bulk, otherwise
+// only the nodes no other version links to are released and the fleet leaves the
+// pool, getting a new one of its own on its next allocation
+void Fleet::releaseTree() {
+    if (m_pool != nullptr && m_pool->getUsers() == 1)
+        m_pool->clear();
+
+    else if (m_pool != nullptr) {
+        releaseNodes(m_root);
+        m_pool->removeUser();
+        m_pool = nullptr;
+    }
+    m_root = nullptr;
+}
+
+// Returns the pool of this fleet, created on first use so that empty and moved-from
+// fleets own none. A new pool carries counts if the aggregates are on
+ShipPool* Fleet::pool() {
+    if (m_pool == nullptr) {
+        m_pool = new ShipPool;
+        if (m_aggregated)
+            m_pool->enableCounts();
+    }
+    return m_pool;
+}
+
+// Releases the nodes of a subtree that no other version links to, in a pre-order
+// walk that stops at nodes still linked from elsewhere
+void Fleet::releaseNodes(Ship* root) {
+    if (root == nullptr)
+        return;
+
+    Ship** stack = new Ship*[root->getHeight() + 2];
+    int depth = 0;
+    stack[depth++] = root;
+    while (depth > 0) {
+        Ship* node = stack[--depth];
+        if (--node->m_refs > 0)
+            continue;
+
+        if (node->getRight() != nullptr)
+            stack[depth++] = node->getRight();
+        if (node->getLeft() != nullptr)
+            stack[depth++] = node->getLeft();
+        m_pool->release(node);
+    }
+    delete[] stack;
+}
+
+// Allocates the empty DENSE bitmap and ship data if they don't exist yet
+void Fleet::allocateDense() {
+    if (m_present != nullptr)
+        return;
+
+    m_present = new uint64_t[DENSEWORDS]();
+    m_shipData = new unsigned char[(IDCOUNT + 1) / 2]();
+}
+
+// Copies the DENSE bitmap and ship data of another fleet
+void Fleet::copyDense(const Fleet& other) {
+    allocateDense();
+    for (int i = 0; i < DENSEWORDS; i++)
+        m_present[i] = other.m_present[i];
+    for (int i = 0; i < (IDCOUNT + 1) / 2; i++)
+        m_shipData[i] = other.m_shipData[i];
+    m_denseSize = other.m_denseSize;
+}
+
+// Deallocates the DENSE bitmap and ship data
+void Fleet::releaseDense() {
+    delete[] m_present;
+    delete[] m_shipData;
+    m_present = nullptr;
+    m_shipData = nullptr;
+    m_denseSize = 0;
+}
+
+// Sets the presence bit of a ship and packs its type and state.
+// Returns false for a duplicate, which is skipped
+bool Fleet::denseInsert(const Ship& ship) {
+    allocateDense();
+    int offset = ship.getID() - MINID;
+    uint64_t bit = uint64_t(1) << (offset % 64);
+    if ((m_present[offset / 64] & bit) != 0)
+        return false;
+
+    m_present[offset / 64] |= bit;
+    m_denseSize++;
+    int shift = (offset % 2) * 4;
+    m_shipData[offset / 2] = (unsigned char)((m_shipData[offset / 2] & ~(15 << shift)) |
+                             ((ship.getType() | (ship.getState() << 3)) << shift));
+    return true;
+}
+
+// Copies the ship with the given ID out of the DENSE arrays, returns false if absent
+bool Fleet::densePeek(int id, Ship& ship) const {
+    if (m_present == nullptr || id < MINID || id > MAXID)
+        return false;
+
+    int offset = id - MINID;
+    if ((m_present[offset / 64] & (uint64_t(1) << (offset % 64))) == 0)
+        return false;
+
+    int data = (m_shipData[offset / 2] >> ((offset % 2) * 4)) & 15;
+    ship = Ship(id, static_cast<SHIPTYPE>(data & 7), static_cast<STATE>(data >> 3));
+    return true;
+}
+
+// Moves every ship of the tree into the DENSE arrays and frees the tree.
+// Uses the path buffer as an explicit stack so degenerate trees are safe
+void Fleet::treeToDense() {
+    allocateDense();
+    int depth = 0;
+    if (m_root != nullptr)
+        recordLink(depth++, &m_root);
+
+    while (depth > 0) {
+        Ship* node = *m_path[--depth];
+        denseInsert(*node);
+
+        if (node->getLeft() != nullptr)
+            recordLink(depth++, &node->m_left);
+        if (node->getRight() != nullptr)
+            recordLink(depth++, &node->m_right);
+    }
+
+    releaseTree();
+}
+
+// Builds a balanced tree from the DENSE arrays, scanning the bitmap words in ID
+// order, and frees the arrays
+void Fleet::denseToTree() {
+    int count = m_denseSize;
+
+    if (count > 0) {
+        Ship** nodes = new Ship*[count];
+        int index = 0;
+        pool()->reserve(count);
+        for (int i = 0; i < DENSEWORDS; i++) {
+            for (uint64_t word = m_present[i]; word != 0; word &= word - 1) {
+                Ship ship;
+                densePeek(MINID + i * 64 + __builtin_ctzll(word), ship);
+                nodes[index++] = m_pool->allocate(ship);
+            }
+        }
+
+        m_root = linkTree(nodes, 0, count - 1, m_threads);
+        delete[] nodes;
+    }
+    releaseDense();
+}
+
+// Prints every ship of a DENSE fleet in ID order
+void Fleet::dumpDense() const {
+    for (int i = 0; m_present != nullptr && i < DENSEWORDS; i++) {
+        for (uint64_t word = m_present[i]; word != 0; word &= word - 1)
+            cout << "(" << MINID + i * 64 + __builtin_ctzll(word) << ")";
+    }
+}
+
+// Returns the offset of the first ship at or after offset in a DENSE fleet, IDCOUNT if none
+int Fleet::nextDense(int offset) const {
+    if (m_present == nullptr || offset >= IDCOUNT)
+        return IDCOUNT;
+
+    // Mask off the bits below offset in the first word
+    int i = offset / 64;
+    uint64_t word = m_present[i] & (~uint64_t(0) << (offset % 64));
+    while (word == 0) {
+        if (++i == DENSEWORDS)
+            return IDCOUNT;
+        word = m_present[i];
+    }
+    return i * 64 + __builtin_ctzll(word);
+}
+
+// Returns the offset of the last ship at or before offset in a DENSE fleet, -1 if none
+int Fleet::previousDense(int offset) const {
+    if (m_present == nullptr || offset < 0)
+        return -1;
+
+    // Mask off the bits above offset in the first word
+    int i = offset / 64;
+    uint64_t word = m_present[i] & (~uint64_t(0) >> (63 - offset % 64));
+    while (word == 0) {
+        if (--i < 0)
+            return -1;
+        word = m_present[i];
+    }
+    return i * 64 + 63 - __builtin_clzll(word);
+}
+
+// Returns the number of ships in the fleet
+int Fleet::size() const{
+    return (m_type == DENSE) ? m_denseSize : subtreeSize(m_root);
+}
+
+// Returns the number of ships with an ID smaller than id, whether or not id is in
+// the fleet. O(log n) on a balanced tree using subtree sizes
+int Fleet::rank(int id) const{
+    if (id <= MINID)
+        return 0;
+
+    if (id > MAXID)
+        return size();
+
+    // DENSE counts the bits below the offset, a bounded scan of at most DENSEWORDS words
+    if (m_type == DENSE) {
+        int count = 0;
+        int offset = id - MINID;
+        for (int i = 0; m_present != nullptr && i <= offset / 64; i++) {
+            uint64_t word = m_present[i];
+            if (i == offset / 64)
+                word &= (uint64_t(1) << (offset % 64)) - 1;
+            count += __builtin_popcountll(word);
+        }
+        return count;
+    }
+
+    // Every time the search turns right, the left subtree and the node are smaller
+    int count = 0;
+    Ship* node = m_root;
+    while (node != nullptr) {
+        if (node->getID() < id) {
+            count += subtreeSize(node->getLeft()) + 1;
+            node = node->getRight();
+        }
+        else
+            node = node->getLeft();
+    }
+    return count;
+}
+
+// Copies the ship with the k-th smallest ID (counting from 0) into ship,
+// returns false if k is out of range
+bool Fleet::select(int k, Ship& ship) const{
+    if (k < 0 || k >= size())
+        return false;
+
+    if (m_type == DENSE) {
+        int i = 0;
+        while (k >= __builtin_popcountll(m_present[i]))
+            k -= __builtin_popcountll(m_present[i++]);
+
+        // Drop the k lowest bits of the word, the next one is the answer
+        uint64_t word = m_present[i];
+        for (; k > 0; k--)
+            word &= word - 1;
+        return densePeek(MINID + i * 64 + __builtin_ctzll(word), ship);
+    }
+
+    Ship* node = m_root;
+    while (subtreeSize(node->getLeft()) != k) {
+        if (k < subtreeSize(node->getLeft()))
+            node = node->getLeft();
+
+        else {
+            k -= subtreeSize(node->getLeft()) + 1;
+            node = node->getRight();
+        }
+    }
+    ship = Ship(node->getID(), node->getType(), node->getState());
+    return true;
+}
+
+// Returns the number of ships with IDs in [lo, hi]
+int Fleet::countInRange(int lo, int hi) const{
+    if (lo > hi)
+        return 0;
+
+    // Every ship lies below any hi past MAXID, and hi + 1 would overflow at INT_MAX
+    if (hi >= MAXID)
+        return size() - rank(lo);
+
+    return rank(hi + 1) - rank(lo);
+}
+
+// Sets the number of threads batch builds, deep copies and validation may use,
+// subtrees below PARALLELCUTOFF ships always stay on one thread
+void Fleet::setThreads(int threads){
+    m_threads = (threads > 1) ? threads : 1;
+}
+
+// Returns the number of threads bulk operations may use
+int Fleet::getThreads() const{
+    return m_threads;
+}
+
+// Checks the whole fleet: BST order, heights, subtree sizes and reference counts of
+// every node and the AVL balance if AVL, or the ship count of the bitmap if DENSE.
+// Large trees are checked on up to m_threads threads
+bool Fleet::validate() const{
+    if (m_type == DENSE) {
+        int count = 0;
+        for (int i = 0; m_present != nullptr && i < DENSEWORDS; i++)
+            count += __builtin_popcountll(m_present[i]);
+        return m_root == nullptr && count == m_denseSize;
+    }
+    return validateTree(m_root, MINID, MAXID, m_threads);
+}
+
+// Validates a subtree whose IDs must lie in [lo, hi]. Every check is local to a node,
+// so below the top levels the nodes are visited with a growing explicit stack
+bool Fleet::validateTree(Ship* root, int lo, int hi, int threads) const{
+    if (root == nullptr)
+        return true;
+
+    if (threads > 1 && root->getSize() >= PARALLELCUTOFF) {
+        if (!validateNode(root, lo, hi))
+            return false;
+
+        bool leftValid = true;
+        thread worker([&]() {leftValid = validateTree(root->getLeft(), lo, root->getID() - 1, threads / 2);});
+        bool rightValid = validateTree(root->getRight(), root->getID() + 1, hi, threads - threads / 2);
+        worker.join();
+        return leftValid && rightValid;
+    }
+
+    struct Bounds{
+        Ship* m_node; // a node still to check
+        int m_lo;     // the smallest ID allowed in its subtree
+        int m_hi;     // the largest ID allowed in its subtree
+    };
+    int capacity = 64;
+    Bounds* stack = new Bounds[capacity];
+    int depth = 0;
+    stack[depth++] = {root, lo, hi};
+
+    bool valid = true;
+    while (valid && depth > 0) {
+        Bounds bounds = stack[--depth];
+        Ship* node = bounds.m_node;
+        valid = validateNode(node, bounds.m_lo, bounds.m_hi);
+
+        if (depth + 2 > capacity) {
+            Bounds* grown = new Bounds[capacity * 2];
+            for (int i = 0; i < depth; i++)
+                grown[i] = stack[i];
+            delete[] stack;
+            stack = grown;
+            capacity *= 2;
+        }
+        if (node->getRight() != nullptr)
+            stack[depth++] = {node->getRight(), node->getID() + 1, bounds.m_hi};
+        if (node->getLeft() != nullptr)
+            stack[depth++] = {node->getLeft(), bounds.m_lo, node->getID() - 1};
+    }
+    delete[] stack;
+    return valid;
+}
+
+// Checks a single node against its ID bounds and its children
+bool Fleet::validateNode(Ship* node, int lo, int hi) const{
+    int leftHeight = height(node->getLeft());
+    int rightHeight = height(node->getRight());
+    int balance = leftHeight - rightHeight;
+    return node->getID() >= lo && node->getID() <= hi && node->m_refs >= 1 &&
+           node->getHeight() == (leftHeight > rightHeight ? leftHeight : rightHeight) + 1 &&
+           node->getSize() == subtreeSize(node->getLeft()) + subtreeSize(node->getRight()) + 1 &&
+           (m_type != AVL || (balance >= -1 && balance <= 1));
+}
+
+// Moves every ship with an ID of at least id into right, replacing its contents.
+// By default right gets its own copies of the ships in its own pool, O(k) for k ships
+// moved. With sharePool the nodes are handed over in O(log n) for AVL fleets instead,
+// after which both fleets allocate from this pool: like snapshots they must not be
+// changed from different threads, and neither gets bulk clear or parallel set
+// operations while the other lives
+void Fleet::split(int id, Fleet& right, bool sharePool){
+    if (&right == this)
+        return;
+
+    right.clear();
+    right.m_type = m_type;
+    if (m_type == DENSE) {
+        int first = (id > MINID) ? id - MINID : 0;
+        for (int offset = nextDense(first); offset < IDCOUNT; offset = nextDense(offset + 1)) {
+            Ship ship;
+            densePeek(offset + MINID, ship);
+            right.denseInsert(ship);
+            right.indexAdd(ship);
+            remove(ship.getID());
+        }
+        return;
+    }
+
+    if (m_type == NONE || m_root == nullptr)
+        return;
+
+    limitHeight(&m_root);
+    Ship* less;
+    Ship* found;
+    Ship* greater;
+    splitTree(m_root, id, less, found, greater);
+    if (found != nullptr)
+        greater = joinTrees(nullptr, found, greater);
+    m_root = less;
+
+    indexTree(greater, false);
+    if (sharePool) {
+        // The moved nodes stay where they are, right shares the pool instead
+        delete right.m_pool;
+        right.m_pool = m_pool;
+        m_pool->addUser();
+        if (right.m_aggregated)
+            m_pool->enableCounts();
+        right.m_root = greater;
+    }
+    else {
+        right.m_root = right.assignmentOperatorHelper(greater);
+        releaseNodes(greater);
+    }
+
+    right.indexTree(right.m_root, true);
+    if (right.m_aggregated && right.m_root != nullptr)
+        right.updateHeights(right.m_root);
+}
+
+// Appends every ship of right, whose IDs must all be larger than those of this fleet,
+// and empties right. Takes O(log n) for AVL fleets when right's pool can be taken over
+// and right is AVL too, otherwise right's ships are copied or rebuilt balanced first,
+// O(k). Overlapping IDs fall back to unionWith
+void Fleet::join(Fleet& right){
+    if (&right == this || m_type == NONE || right.size() == 0)
+        return;
+
+    Ship last;
+    Ship first;
+    bool overlap = select(size() - 1, last) && right.select(0, first) && last.getID() >= first.getID();
+    if (m_type == DENSE || right.m_type == DENSE || overlap) {
+        unionWith(right);
+        right.clear();
+        return;
+    }
+
+    // Take right's nodes without copying if they can belong to this pool
+    Ship* other;
+    if (right.m_pool == m_pool || right.m_pool->getUsers() == 1) {
+        if (right.m_pool != m_pool)
+            pool()->adopt(*right.m_pool);
+        other = right.m_root;
+        right.m_root = nullptr;
+
+        // The joins keep an AVL fleet balanced only if both trees are AVL shaped
+        if (m_type == AVL && right.m_type != AVL)
+            rebuildBalanced(&other);
+        else if (m_aggregated)
+            updateHeights(other);
+    }
+    else
+        other = buildTree(right);
+
+    indexTree(other, true);
+    right.clear();
+
+    limitHeight(&m_root);
+    limitHeight(&other);
+    m_root = join2(m_root, other);
+}
+
+// Adds every ship of other, resolving the ships in both fleets by policy with this
+// fleet on the left. Other's m ships are copied into this pool in O(m), then the
+// recursive union takes O(m log(n/m + 1)) for AVL fleets, on m_threads threads
+// unless snapshots share the pool
+void Fleet::unionWith(const Fleet& other, DUPLICATE policy){
+    if (m_type == NONE || &other == this)
+        return;
+
+    if (m_type == DENSE) {
+        for (const_iterator it = other.begin(); it != other.end(); ++it) {
+            Ship ship;
+            if (densePeek(it->getID(), ship))
+                denseKeep(ship, *it, policy);
+
+            else if (denseInsert(*it))
+                indexAdd(*it);
+        }
+        return;
+    }
+
+    limitHeight(&m_root);
+    mutex lock;
+    SetOperation operation = {policy, (m_threads > 1 && pool()->getUsers() == 1) ? &lock : nullptr};
+    m_root = unionTrees(m_root, buildTree(other), operation, m_threads);
+}
+
+// Keeps only the ships also in other, resolved by policy with this fleet on the
+// left, in the time of unionWith
+void Fleet::intersectWith(const Fleet& other, DUPLICATE policy){
+    if (m_type == NONE || &other == this)
+        return;
+
+    if (m_type == DENSE) {
+        uint64_t* mask = new uint64_t[DENSEWORDS]();
+        for (const_iterator it = other.begin(); it != other.end(); ++it) {
+            int offset = it->getID() - MINID;
+            mask[offset / 64] |= uint64_t(1) << (offset % 64);
+        }
+        for (int offset = nextDense(0); offset < IDCOUNT; offset = nextDense(offset + 1)) {
+            Ship ship;
+            Ship match;
+            densePeek(offset + MINID, ship);
+            if ((mask[offset / 64] & (uint64_t(1) << (offset % 64))) == 0)
+                remove(ship.getID());
+
+            else if (other.peek(ship.getID(), match))
+                denseKeep(ship, match, policy);
+        }
+        delete[] mask;
+        return;
+    }
+
+    limitHeight(&m_root);
+    mutex lock;
+    SetOperation operation = {policy, (m_threads > 1 && pool()->getUsers() == 1) ? &lock : nullptr};
+    m_root = intersectTrees(m_root, buildTree(other), operation, m_threads);
+}
+
+// Removes every ship that is also in other, in the time of unionWith
+void Fleet::differenceWith(const Fleet& other){
+    if (m_type == NONE)
+        return;
+
+    if (&other == this) {
+        clear();
+        return;
+    }
+
+    if (m_type == DENSE) {
+        for (const_iterator it = other.begin(); it != other.end(); ++it)
+            remove(it->getID());
+        return;
+    }
+
+    limitHeight(&m_root);
+    mutex lock;
+    SetOperation operation = {KEEPLEFT, (m_threads > 1 && pool()->getUsers() == 1) ? &lock : nullptr};
+    m_root = differenceTrees(m_root, buildTree(other), operation, m_threads);
+}
+
+// Copies the ships of another fleet into this pool as a balanced tree, O(m)
+Ship* Fleet::buildTree(const Fleet& other) {
+    int count = other.size();
+    if (count == 0)
+        return nullptr;
+
+    Ship** nodes = new Ship*[count];
+    pool()->reserve(count);
+    int i = 0;
+    for (const_iterator it = other.begin(); it != other.end(); ++it)
+        nodes[i++] = m_pool->allocate(*it);
+
+    Ship* root = linkTree(nodes, 0, count - 1, m_threads);
+    delete[] nodes;
+    return root;
+}
+
+// Joins two subtrees and a detached key whose ID lies between theirs into one tree,
+// AVL balanced if both are, in time proportional to their height difference
+Ship* Fleet::joinTrees(Ship* left, Ship* key, Ship* right) {
+    if (height(left) > height(right) + 1)
+        return joinRight(left, key, right);
+
+    if (height(right) > height(left) + 1)
+        return joinLeft(left, key, right);
+
+    key->setLeft(left);
+    key->setRight(right);
+    updateNode(key);
+    return key;
+}
+
+// Hangs the key and the shorter left tree on the left spine of the taller right
+// tree, rebalancing on the way back up
+Ship* Fleet::joinLeft(Ship* left, Ship* key, Ship* right) {
+    unshare(&right);
+    if (height(right->getLeft()) <= height(left) + 1) {
+        key->setLeft(left);
+        key->setRight(right->getLeft());
+        updateNode(key);
+        right->setLeft(key);
+    }
+    else
+        right->setLeft(joinLeft(left, key, right->getLeft()));
+
+    return rebalance(right);
+}
+
+// Hangs the key and the shorter right tree on the right spine of the taller left
+// tree, rebalancing on the way back up
+Ship* Fleet::joinRight(Ship* left, Ship* key, Ship* right) {
+    unshare(&left);
+    if (height(left->getRight()) <= height(right) + 1) {
+        key->setLeft(left->getRight());
+        key->setRight(right);
+        updateNode(key);
+        left->setRight(key);
+    }
+    else
+        left->setRight(joinRight(left->getRight(), key, right));
+
+    return rebalance(left);
+}
+
+// Joins two subtrees whose IDs are all smaller in left than in right, using the
+// largest node of left as the key
+Ship* Fleet::join2(Ship* left, Ship* right) {
+    if (left == nullptr)
+        return right;
+
+    if (right == nullptr)
+        return left;
+
+    Ship* last;
+    Ship* rest = splitLast(left, last);
+    return joinTrees(rest, last, right);
+}
+
+// Detaches the node with the largest ID of a subtree into last and returns the rest
+Ship* Fleet::splitLast(Ship* root, Ship*& last) {
+    unshare(&root);
+    Ship* left = root->getLeft();
+    Ship* right = root->getRight();
+    if (right == nullptr) {
+        root->setLeft(nullptr);
+        updateNode(root);
+        last = root;
+        return left;
+    }
+    return joinTrees(left, root, splitLast(right, last));
+}
+
+// Splits a subtree into the trees of the IDs below and above id and the detached
+// node with the ID itself, or nullptr. The nodes on the search path are joined back
+// on the way up, O(log n) in total for AVL trees
+void Fleet::splitTree(Ship* root, int id, Ship*& less, Ship*& found, Ship*& greater) {
+    if (root == nullptr) {
+        less = found = greater = nullptr;
+        return;
+    }
+
+    unshare(&root);
+    Ship* left = root->getLeft();
+    Ship* right = root->getRight();
+    Ship* rest;
+    if (root->getID() == id) {
+        root->setLeft(nullptr);
+        root->setRight(nullptr);
+        updateNode(root);
+        less = left;
+        found = root;
+        greater = right;
+    }
+    else if (id < root->getID()) {
+        splitTree(left, id, less, found, rest);
+        greater = joinTrees(rest, root, right);
+    }
+    else {
+        splitTree(right, id, rest, found, greater);
+        less = joinTrees(left, root, rest);
+    }
+}
+
+// Returns the union of a, a subtree of this fleet, and b, a subtree of copies of the
+// other fleet's ships. a is split around the root of b, the halves are merged with
+// b's subtrees, on two threads if they are large, and joined back with a single root
+Ship* Fleet::unionTrees(Ship* a, Ship* b, const SetOperation& operation, int threads) {
+    if (b == nullptr)
+        return a;
+
+    if (a == nullptr) {
+        unique_lock<mutex> guard = setLock(operation);
+        indexTree(b, true);
+        return b;
+    }
+
+    Ship* less;
+    Ship* found;
+    Ship* greater;
+    splitTree(a, b->getID(), less, found, greater);
+    Ship* otherLess = b->getLeft();
+    Ship* otherGreater = b->getRight();
+    Ship* key = b;
+    if (found != nullptr) {
+        keepDuplicate(found, *b, operation);
+        unique_lock<mutex> guard = setLock(operation);
+        m_pool->release(b);
+        key = found;
+    }
+    else {
+        unique_lock<mutex> guard = setLock(operation);
+        indexAdd(*b);
+    }
+
+    Ship* left = nullptr;
+    Ship* right;
+    int size = subtreeSize(less) + subtreeSize(greater) + subtreeSize(otherLess) + subtreeSize(otherGreater);
+    if (operation.m_lock != nullptr && threads > 1 && size >= PARALLELCUTOFF) {
+        thread worker([&]() {left = unionTrees(less, otherLess, operation, threads / 2);});
+        right = unionTrees(greater, otherGreater, operation, threads - threads / 2);
+        worker.join();
+    }
+    else {
+        left = unionTrees(less, otherLess, operation, threads);
+        right = unionTrees(greater, otherGreater, operation, threads);
+    }
+    return joinTrees(left, key, right);
+}
+
+// Returns the intersection of a, a subtree of this fleet, and b, a subtree of copies
+// of the other fleet's ships, releasing every other node. Recurses like unionTrees
+Ship* Fleet::intersectTrees(Ship* a, Ship* b, const SetOperation& operation, int threads) {
+    if (a == nullptr || b == nullptr) {
+        discardTree(a, true, operation);
+        discardTree(b, false, operation);
+        return nullptr;
+    }
+
+    Ship* less;
+    Ship* found;
+    Ship* greater;
+    splitTree(a, b->getID(), less, found, greater);
+    Ship* otherLess = b->getLeft();
+    Ship* otherGreater = b->getRight();
+    if (found != nullptr)
+        keepDuplicate(found, *b, operation);
+    {
+        unique_lock<mutex> guard = setLock(operation);
+        m_pool->release(b);
+    }
+
+    Ship* left = nullptr;
+    Ship* right;
+    int size = subtreeSize(less) + subtreeSize(greater) + subtreeSize(otherLess) + subtreeSize(otherGreater);
+    if (operation.m_lock != nullptr && threads > 1 && size >= PARALLELCUTOFF) {
+        thread worker([&]() {left = intersectTrees(less, otherLess, operation, threads / 2);});
+        right = intersectTrees(greater, otherGreater, operation, threads - threads / 2);
+        worker.join();
+    }
+    else {
+        left = intersectTrees(less, otherLess, operation, threads);
+        right = intersectTrees(greater, otherGreater, operation, threads);
+    }
+    return (found != nullptr) ? joinTrees(left, found, right) : join2(left, right);
+}
+
+// Returns a, a subtree of this fleet, without the IDs of b, a subtree of copies of
+// the other fleet's ships, releasing every node of b. Recurses like unionTrees
+Ship* Fleet::differenceTrees(Ship* a, Ship* b, const SetOperation& operation, int threads) {
+    if (a == nullptr || b == nullptr) {
+        discardTree(b, false, operation);
+        return a;
+    }
+
+    Ship* less;
+    Ship* found;
+    Ship* greater;
+    splitTree(a, b->getID(), less, found, greater);
+    Ship* otherLess = b->getLeft();
+    Ship* otherGreater = b->getRight();
+    {
+        unique_lock<mutex> guard = setLock(operation);
+        m_pool->release(b);
+        if (found != nullptr) {
+            indexRemove(*found);
+            m_pool->release(found);
+        }
+    }
+
+    Ship* left = nullptr;
+    Ship* right;
+    int size = subtreeSize(less) + subtreeSize(greater) + subtreeSize(otherLess) + subtreeSize(otherGreater);
+    if (operation.m_lock != nullptr && threads > 1 && size >= PARALLELCUTOFF) {
+        thread worker([&]() {left = differenceTrees(less, otherLess, operation, threads / 2);});
+        right = differenceTrees(greater, otherGreater, operation, threads - threads / 2);
+        worker.join();
+    }
+    else {
+        left = differenceTrees(less, otherLess, operation, threads);
+        right = differenceTrees(greater, otherGreater, operation, threads);
+    }
+    return join2(left, right);
+}
+
+// Returns a subtree without the ships of count sorted, distinct IDs. The subtree is
+// split around the middle ID, the halves are processed on two threads if they are
+// large, and joined back
+Ship* Fleet::removeSorted(Ship* root, const int* ids, int count, const SetOperation& operation, int threads) {
+    if (root == nullptr || count == 0)
+        return root;
+
+    int middle = count / 2;
+    Ship* less;
+    Ship* found;
+    Ship* greater;
+    splitTree(root, ids[middle], less, found, greater);
+    if (found != nullptr) {
+        unique_lock<mutex> guard = setLock(operation);
+        indexRemove(*found);
+        m_pool->release(found);
+    }
+
+    Ship* left = nullptr;
+    Ship* right;
+    const int* upper = ids + middle + 1;
+    int upperCount = count - middle - 1;
+    if (operation.m_lock != nullptr && threads > 1 && subtreeSize(less) + subtreeSize(greater) >= PARALLELCUTOFF) {
+        thread worker([&]() {left = removeSorted(less, ids, middle, operation, threads / 2);});
+        right = removeSorted(greater, upper, upperCount, operation, threads - threads / 2);
+        worker.join();
+    }
+    else {
+        left = removeSorted(less, ids, middle, operation, threads);
+        right = removeSorted(greater, upper, upperCount, operation, threads);
+    }
+    return join2(left, right);
+}
+
+// Returns the ship kept for an ID in both fleets of a set operation. MERGESTATE keeps
+// the left type and a ship lost in either fleet stays lost
+static Ship resolveDuplicate(const Ship& left, const Ship& right, DUPLICATE policy){
+    if (policy == KEEPRIGHT)
+        return Ship(left.getID(), right.getType(), right.getState());
+
+    if (policy == MERGESTATE && right.getState() == LOST)
+        return Ship(left.getID(), left.getType(), LOST);
+
+    return Ship(left.getID(), left.getType(), left.getState());
+}
+
+// Gives a node of this fleet the type and state resolved against the other fleet's copy
+void Fleet::keepDuplicate(Ship* node, const Ship& other, const SetOperation& operation) {
+    Ship kept = resolveDuplicate(*node, other, operation.m_policy);
+    if (kept.getType() == node->getType() && kept.getState() == node->getState())
+        return;
+
+    unique_lock<mutex> guard = setLock(operation);
+    indexRemove(*node);
+    node->setType(kept.getType());
+    node->setState(kept.getState());
+    indexAdd(*node);
+}
+
+// Releases a subtree dropped by a set operation, taking its ships out of the index
+// if they belong to this fleet
+void Fleet::discardTree(Ship* root, bool indexed, const SetOperation& operation) {
+    unique_lock<mutex> guard = setLock(operation);
+    if (indexed)
+        indexTree(root, false);
+    releaseNodes(root);
+}
+
+// Locks the pool and the index if a set operation runs on several threads
+unique_lock<mutex> Fleet::setLock(const SetOperation& operation) const {
+    return (operation.m_lock != nullptr) ? unique_lock<mutex>(*operation.m_lock) : unique_lock<mutex>();
+}
+
+// Gives a ship of a DENSE fleet the type and state resolved against the other fleet's copy
+void Fleet::denseKeep(const Ship& ship, const Ship& other, DUPLICATE policy) {
+    Ship kept = resolveDuplicate(ship, other, policy);
+    if (kept.getType() == ship.getType() && kept.getState() == ship.getState())
+        return;
+
+    remove(ship.getID());
+    denseInsert(kept);
+    indexAdd(kept);
+}
+
+// Fleet files start with a header of four little-endian 32-bit words: the magic number,
+// the format version, the tree type and the ship count. One word per ship follows,
+// the ID offset in the low 17 bits, then 3 bits of type and 1 bit of state. Tree
+// fleets are written in pre-order, which fixes the shape, DENSE fleets in ID order
+const uint32_t FLEETFILEMAGIC = 0x544c4653; // "SFLT"
+const int FLEETHEADERWORDS = 4;
+
+// Stores a 32-bit word in little-endian byte order
+static void writeWord(unsigned char* bytes, uint32_t word){
+    for (int i = 0; i < 4; i++)
+        bytes[i] = (unsigned char)(word >> (8 * i));
+}
+
+// Reads a 32-bit word stored in little-endian byte order
+static uint32_t readWord(const unsigned char* bytes){
+    return uint32_t(bytes[0]) | uint32_t(bytes[1]) << 8 | uint32_t(bytes[2]) << 16 | uint32_t(bytes[3]) << 24;
+}
+
+// Writes the fleet to a file in one write, returns false if the file can't be written
+bool Fleet::save(const string& path) const{
+    int count = size();
+    unsigned char* bytes = new unsigned char[(FLEETHEADERWORDS + count) * 4];
+    writeWord(bytes, FLEETFILEMAGIC);
+    writeWord(bytes + 4, FLEETFILEVERSION);
+    writeWord(bytes + 8, m_type);
+    writeWord(bytes + 12, count);
+
+    unsigned char* record = bytes + FLEETHEADERWORDS * 4;
+    if (m_type == DENSE) {
+        for (const_iterator it = begin(); it != end(); ++it, record += 4)
+            writeWord(record, (it->getID() - MINID) | it->getType() << 17 | it->getState() << 20);
+    }
+    else if (m_root != nullptr) {
+        // Pre-order walk with an explicit stack no deeper than the height
+        Ship** stack = new Ship*[m_root->getHeight() + 2];
+        int depth = 0;
+        stack[depth++] = m_root;
+        while (depth > 0) {
+            Ship* node = stack[--depth];
+            writeWord(record, (node->getID() - MINID) | node->getType() << 17 | node->getState() << 20);
+            record += 4;
+            if (node->getRight() != nullptr)
+                stack[depth++] = node->getRight();
+            if (node->getLeft() != nullptr)
+                stack[depth++] = node->getLeft();
+        }
+        delete[] stack;
+    }
+
+    ofstream file(path.c_str(), ios::binary | ios::trunc);
+    file.write(reinterpret_cast<const char*>(bytes), (FLEETHEADERWORDS + count) * 4);
+    delete[] bytes;
+    file.close();
+    return bool(file);
+}
+
+// Replaces the fleet with one written by save, in O(n) without any rebalancing: the
+// file is read in one go, tree nodes fill one contiguous block in pre-order and are
+// linked back into the saved shape. The threads, index and aggregate settings of this
+// fleet are kept. Returns false and leaves the fleet as it was if the file can't be
+// read, has another version or doesn't hold a valid fleet
+bool Fleet::load(const string& path){
+    ifstream file(path.c_str(), ios::binary | ios::ate);
+    if (!file)
+        return false;
+
+    streamoff length = file.tellg();
+    if (length < FLEETHEADERWORDS * 4 || length % 4 != 0 || length > (FLEETHEADERWORDS + IDCOUNT) * 4)
+        return false;
+
+    unsigned char* bytes = new unsigned char[length];
+    file.seekg(0);
+    file.read(reinterpret_cast<char*>(bytes), length);
+    uint32_t type = readWord(bytes + 8);
+    uint32_t count = readWord(bytes + 12);
+    bool valid = file && readWord(bytes) == FLEETFILEMAGIC && readWord(bytes + 4) == FLEETFILEVERSION &&
+                 type <= DENSE && count == length / 4 - FLEETHEADERWORDS && (type != NONE || count == 0);
+
+    Fleet loaded(valid ? static_cast<TREETYPE>(type) : NONE);
+    loaded.setThreads(m_threads);
+    loaded.setAggregated(isAggregated());
+    Ship* block = (valid && type != DENSE && count > 0) ? loaded.pool()->allocateBlock(count) : nullptr;
+    for (uint32_t i = 0; valid && i < count; i++) {
+        uint32_t word = readWord(bytes + (FLEETHEADERWORDS + i) * 4);
+        int offset = word & 0x1ffff;
+        int shipType = (word >> 17) & 7;
+        valid = offset < IDCOUNT && shipType <= ROBOCARRIER && (word >> 21) == 0;
+
+        Ship ship(offset + MINID, static_cast<SHIPTYPE>(shipType), static_cast<STATE>((word >> 20) & 1));
+        if (valid && type == DENSE)
+            valid = loaded.denseInsert(ship);
+        else if (valid)
+            block[i].reset(ship);
+    }
+    delete[] bytes;
+
+    if (valid && block != nullptr) {
+        loaded.m_root = loaded.linkPreorder(block, count);
+        valid = loaded.m_root != nullptr;
+        if (valid)
+            loaded.updateHeights(loaded.m_root);
+    }
+    if (!valid || !loaded.validate())
+        return false;
+
+    loaded.setIndexed(isIndexed());
+    swap(loaded);
+    return true;
+}
+
+// Links count nodes holding the pre-order of a tree back into that tree and returns
+// its root, or nullptr for a repeated ID. Every node becomes the left child of the
+// node before it if its ID is smaller, otherwise the right child of the last node
+// it is larger than among the ancestors still open on the right. Other ordering
+// errors are left for validation
+Ship* Fleet::linkPreorder(Ship* block, int count) {
+    Ship** stack = new Ship*[count];
+    int depth = 0;
+    stack[depth++] = &block[0];
+    for (int i = 1; i < count; i++) {
+        Ship* node = &block[i];
+        if (node->getID() < stack[depth - 1]->getID())
+            stack[depth - 1]->setLeft(node);
+
+        else {
+            Ship* parent = nullptr;
+            while (depth > 0 && stack[depth - 1]->getID() < node->getID())
+                parent = stack[--depth];
+            if (parent == nullptr) {
+                delete[] stack;
+                return nullptr;
+            }
+            parent->setRight(node);
+        }
+        stack[depth++] = node;
+    }
+    delete[] stack;
+    return &block[0];
+}
+
+// Turns the type and state index on or off. Turning it on indexes the current
+// ships in linear time, afterwards insert and remove keep it up to date
+void Fleet::setIndexed(bool indexed){
+    if (!indexed) {
+        delete m_index;
+        m_index = nullptr;
+    }
+    else if (m_index == nullptr) {
+        m_index = new ShipIndex;
+        for (const_iterator it = begin(); it != end(); ++it)
+            m_index->add(*it);
+    }
+}
+
+// Returns true if the type and state index is on
+bool Fleet::isIndexed() const{
+    return m_index != nullptr;
+}
+
+// Returns the number of ships with the given type and state,
+// O(1) with the index, a full traversal without it
+int Fleet::count(SHIPTYPE type, STATE state) const{
+    if (m_index != nullptr)
+        return m_index->count(type, state);
+
+    int count = 0;
+    for (const_iterator it = begin(); it != end(); ++it) {
+        if (it->getType() == type && it->getState() == state)
+            count++;
+    }
+    return count;
+}
+
+// Returns the number of ships with the given type in any state
+int Fleet::countByType(SHIPTYPE type) const{
+    return count(type, ALIVE) + count(type, LOST);
+}
+
+// Returns the number of ships in the given state of any type
+int Fleet::countByState(STATE state) const{
+    int total = 0;
+    for (int type = CARGO; type <= ROBOCARRIER; type++)
+        total += count(static_cast<SHIPTYPE>(type), state);
+    return total;
+}
+
+// Copies up to maxShips ships with the given type and state into ships and returns
+// how many were copied. O(k) with the index, in no particular order; in ID order
+// by a full traversal without it
+int Fleet::listShips(SHIPTYPE type, STATE state, Ship* ships, int maxShips) const{
+    if (m_index != nullptr)
+        return m_index->list(type, state, ships, maxShips);
+
+    int count = 0;
+    for (const_iterator it = begin(); it != end() && count < maxShips; ++it) {
+        if (it->getType() == type && it->getState() == state)
+            ships[count++] = Ship(it->getID(), type, state);
+    }
+    return count;
+}
+
+// Turns the subtree aggregates on or off. Turning them on makes the pool carry counts
+// for every node and fills them for the current tree in linear time, afterwards every
+// node update keeps them up to date. The counts stay allocated while the pool lives
+void Fleet::setAggregated(bool aggregated){
+    if (!aggregated)
+        m_aggregated = false;
+
+    else if (!m_aggregated) {
+        m_aggregated = true;
+        if (m_pool != nullptr)
+            m_pool->enableCounts();
+        unshareAll(&m_root);
+        if (m_root != nullptr)
+            updateHeights(m_root);
+    }
+}
+
+// Returns true if the subtree aggregates are on
+bool Fleet::isAggregated() const{
+    return m_aggregated;
+}
+
+// Fills counts with the number of ships of every type and state with IDs in [lo, hi].
+// O(log n) for a balanced tree with the aggregates on, otherwise the range is walked
+void Fleet::aggregateRange(int lo, int hi, int counts[5][2]) const{
+    for (int type = 0; type < 5; type++)
+        counts[type][ALIVE] = counts[type][LOST] = 0;
+
+    if (lo > hi)
+        return;
+
+    if (!m_aggregated || m_type == DENSE) {
+        for (const_iterator it = lower_bound(lo); it != end() && it->getID() <= hi; ++it)
+            counts[it->getType()][it->getState()]++;
+        return;
+    }
+
+    // The range is everything below hi + 1 minus everything below lo, with hi
+    // clamped so that hi + 1 cannot overflow
+    if (hi > MAXID)
+        hi = MAXID;
+    int below[SHIPCLASSES];
+    aggregateBelow(hi + 1, &counts[0][0]);
+    aggregateBelow(lo, below);
+    for (int i = 0; i < SHIPCLASSES; i++)
+        (&counts[0][0])[i] -= below[i];
+}
+
+// Returns the type and state counts of a subtree, nullptr for an empty subtree
+const int* Fleet::aggregate(Ship* node) const {
+    return (node != nullptr) ? node->m_counts : nullptr;
+}
+
+// Recomputes the type and state counts of a single node from its children
+void Fleet::updateAggregate(Ship* node) {
+    int* counts = node->m_counts;
+    const int* left = aggregate(node->getLeft());
+    const int* right = aggregate(node->getRight());
+    for (int i = 0; i < SHIPCLASSES; i++)
+        counts[i] = ((left != nullptr) ? left[i] : 0) + ((right != nullptr) ? right[i] : 0);
+    counts[node->getType() * 2 + node->getState()]++;
+}
+
+// Sums the type and state counts of every ship with an ID smaller than id, like rank
+void Fleet::aggregateBelow(int id, int* counts) const {
+    for (int i = 0; i < SHIPCLASSES; i++)
+        counts[i] = 0;
+
+    Ship* node = m_root;
+    while (node != nullptr) {
+        if (node->getID() < id) {
+            const int* left = aggregate(node->getLeft());
+            for (int i = 0; left != nullptr && i < SHIPCLASSES; i++)
+                counts[i] += left[i];
+            counts[node->getType() * 2 + node->getState()]++;
+            node = node->getRight();
+        }
+        else
+            node = node->getLeft();
+    }
+}
+
+// Adds a ship to the type and state index if it is on
+void Fleet::indexAdd(const Ship& ship) {
+    if (m_index != nullptr)
+        m_index->add(ship);
+}
+
+// Removes a ship from the type and state index if it is on
+void Fleet::indexRemove(const Ship& ship) {
+    if (m_index != nullptr)
+        m_index->remove(ship);
+}
+
+// Adds or removes every ship of a subtree to or from the index if it is on
+void Fleet::indexTree(Ship* root, bool add) {
+    if (m_index == nullptr || root == nullptr)
+        return;
+
+    Ship** stack = new Ship*[root->getHeight() + 2];
+    int depth = 0;
+    stack[depth++] = root;
+    while (depth > 0) {
+        Ship* node = stack[--depth];
+        if (add)
+            m_index->add(*node);
+        else
+            m_index->remove(*node);
+
+        if (node->getRight() != nullptr)
+            stack[depth++] = node->getRight();
+        if (node->getLeft() != nullptr)
+            stack[depth++] = node->getLeft();
+    }
+    delete[] stack;
+}
+
+// Returns an iterator to the ship with the smallest ID
+Fleet::const_iterator Fleet::begin() const{
+    const_iterator it(this);
+    if (m_type != DENSE) {
+        it.reserveStack();
+        it.pushLeftSpine(m_root);
+    }
+
+    else if ((it.m_offset = nextDense(0)) != IDCOUNT)
+        densePeek(MINID + it.m_offset, it.m_ship);
+    return it;
+}
+
+// Returns the iterator past the ship with the largest ID
+Fleet::const_iterator Fleet::end() const{
+    return const_iterator(this);
+}
+
+// Returns an iterator to the first ship whose ID is not less than id
+Fleet::const_iterator Fleet::lower_bound(int id) const{
+    const_iterator it(this);
+    if (m_type == DENSE) {
+        it.m_offset = nextDense(id < MINID ? 0 : id - MINID);
+        if (it.m_offset != IDCOUNT)
+            densePeek(MINID + it.m_offset, it.m_ship);
+        return it;
+    }
+
+    // The answer is the last node on the search path where the search turned left,
+    // the path to it is a prefix of the search path
+    it.reserveStack();
+    int found = 0;
+    for (Ship* node = m_root; node != nullptr; ) {
+        it.m_stack[it.m_depth++] = node;
+        if (node->getID() >= id) {
+            found = it.m_depth;
+            node = node->getLeft();
+        }
+        else
+            node = node->getRight();
+    }
+    it.m_depth = found;
+    return it;
+}
+
+// Creates an iterator at end() without a stack, so end() never allocates
+Fleet::const_iterator::const_iterator(const Fleet* fleet) : m_fleet(fleet), m_stack(nullptr), m_depth(0),
+                                                            m_capacity(0), m_offset(IDCOUNT){
+}
+
+// Allocates the stack for the tallest path of the fleet unless there is one
+void Fleet::const_iterator::reserveStack(){
+    if (m_stack == nullptr && m_fleet->m_root != nullptr) {
+        m_capacity = m_fleet->m_root->getHeight() + 1;
+        m_stack = new Ship*[m_capacity];
+    }
+}
+
+// Creates an iterator that belongs to no fleet
+Fleet::const_iterator::const_iterator() : m_fleet(nullptr), m_stack(nullptr), m_depth(0), m_capacity(0),
+                                          m_offset(IDCOUNT){
+}
+
+// Copy constructor, the copy gets its own stack
+Fleet::const_iterator::const_iterator(const const_iterator& rhs) : const_iterator(){
+    *this = rhs;
+}
+
+Fleet::const_iterator::~const_iterator(){
+    delete[] m_stack;
+}
+
+Fleet::const_iterator & Fleet::const_iterator::operator=(const const_iterator & rhs){
+    if (this != &rhs) {
+        if (m_capacity != rhs.m_capacity) {
+            delete[] m_stack;
+            m_stack = (rhs.m_capacity > 0) ? new Ship*[rhs.m_capacity] : nullptr;
+            m_capacity = rhs.m_capacity;
+        }
+        for (int i = 0; i < rhs.m_depth; i++)
+            m_stack[i] = rhs.m_stack[i];
+
+        m_fleet = rhs.m_fleet;
+        m_depth = rhs.m_depth;
+        m_offset = rhs.m_offset;
+        m_ship = rhs.m_ship;
+    }
+    return *this;
+}
+
+const Ship& Fleet::const_iterator::operator*() const{
+    return (m_fleet->m_type == DENSE) ? m_ship : *m_stack[m_depth - 1];
+}
+
+const Ship* Fleet::const_iterator::operator->() const{
+    return &**this;
+}
+
+// Moves to the ship with the next larger ID
+Fleet::const_iterator & Fleet::const_iterator::operator++(){
+    if (m_fleet->m_type == DENSE) {
+        m_offset = m_fleet->nextDense(m_offset + 1);
+        if (m_offset != IDCOUNT)
+            m_fleet->densePeek(MINID + m_offset, m_ship);
+        return *this;
+    }
+
+    Ship* current = m_stack[m_depth - 1];
+    if (current->getRight() != nullptr)
+        pushLeftSpine(current->getRight());
+
+    else {
+        // Climb until we leave a left subtree, the parent is next
+        Ship* child;
+        do {
+            child = m_stack[--m_depth];
+        } while (m_depth > 0 && m_stack[m_depth - 1]->getRight() == child);
+    }
+    return *this;
+}
+
+Fleet::const_iterator Fleet::const_iterator::operator++(int){
+    const_iterator old(*this);
+    ++*this;
+    return old;
+}
+
+// Moves to the ship with the next smaller ID, end() moves to the largest ID
+Fleet::const_iterator & Fleet::const_iterator::operator--(){
+    if (m_fleet->m_type == DENSE) {
+        m_offset = m_fleet->previousDense(m_offset - 1);
+        if (m_offset < 0)
+            m_offset = IDCOUNT;
+
+        else
+            m_fleet->densePeek(MINID + m_offset, m_ship);
+        return *this;
+    }
+
+    if (m_depth == 0) {
+        reserveStack();
+        pushRightSpine(m_fleet->m_root);
+    }
+
+    else if (m_stack[m_depth - 1]->getLeft() != nullptr)
+        pushRightSpine(m_stack[m_depth - 1]->getLeft());
+
+    else {
+        // Climb until we leave a right subtree, the parent is previous
+        Ship* child;
+        do {
+            child = m_stack[--m_depth];
+        } while (m_depth > 0 && m_stack[m_depth - 1]->getLeft() == child);
+    }
+    return *this;
+}
+
+Fleet::const_iterator Fleet::const_iterator::operator--(int){
+    const_iterator old(*this);
+    --*this;
+    return old;
+}
+
+bool Fleet::const_iterator::operator==(const const_iterator & rhs) const{
+    if (m_depth == 0 || rhs.m_depth == 0)
+        return m_depth == rhs.m_depth && m_offset == rhs.m_offset;
+
+    return m_stack[m_depth - 1] == rhs.m_stack[rhs.m_depth - 1];
+}
+
+bool Fleet::const_iterator::operator!=(const const_iterator & rhs) const{
+    return !(*this == rhs);
+}
+
+// Pushes a node and its chain of left children, the smallest ID ends on top
+void Fleet::const_iterator::pushLeftSpine(Ship* node){
+    for (; node != nullptr; node = node->getLeft())
+        m_stack[m_depth++] = node;
+}
+
+// Pushes a node and its chain of right children, the largest ID ends on top
+void Fleet::const_iterator::pushRightSpine(Ship* node){
+    for (; node != nullptr; node = node->getRight())
+        m_stack[m_depth++] = node;
+}
+
+// Creates an empty pool, the first slab is allocated on demand
+ShipPool::ShipPool() : m_slabs(nullptr), m_used(0), m_free(nullptr), m_slabCount(0), m_users(1), m_counted(false){
+}
+
+// Releases every slab
+ShipPool::~ShipPool(){
+    clear();
+}
+
+// Returns a node holding the ID, type and state of ship with no children.
+// Reuses a released node if any, otherwise bumps the index of the current slab
+Ship* ShipPool::allocate(const Ship& ship){
+    Ship* node = m_free;
+    if (node != nullptr)
+        m_free = node->getLeft();
+
+    else {
+        if (m_slabs == nullptr || m_used == m_slabs->m_capacity)
+            reserve(1);
+
+        node = &m_slabs->m_ships[m_used++];
+    }
+
+    node->reset(ship);
+    return node;
+}
+
+// Puts a node on the free list for reuse
+void ShipPool::release(Ship* ship){
+    ship->setRight(nullptr);
+    ship->setLeft(m_free);
+    m_free = ship;
+}
+
+// Makes sure the next count allocations that miss the free list come from
+// one contiguous region of the current slab
+void ShipPool::reserve(int count){
+    if (m_slabs != nullptr && m_slabs->m_capacity - m_used >= count)
+        return;
+
+    // Slabs double in size up to a limit so small fleets stay small
+    const int minCapacity = 64;
+    const int maxCapacity = 4096;
+    int capacity = (m_slabs != nullptr) ? m_slabs->m_capacity * 2 : minCapacity;
+    if (capacity > maxCapacity)
+        capacity = maxCapacity;
+
+    if (capacity < count)
+        capacity = count;
+
+    Slab* slab = new Slab;
+    slab->m_ships = new Ship[capacity];
+    slab->m_capacity = capacity;
+    slab->m_counts = nullptr;
+    if (m_counted)
+        addCounts(slab);
+    slab->m_next = m_slabs;
+    m_slabs = slab;
+    m_used = 0;
+    m_slabCount++;
+}
+
+// Hands out count contiguous nodes at once, the caller sets every one of them
+Ship* ShipPool::allocateBlock(int count){
+    reserve(count);
+    Ship* block = &m_slabs->m_ships[m_used];
+    m_used += count;
+    return block;
+}
+
+// Takes over every slab of another pool, whose nodes then belong to this pool, in
+// time linear in the number of slabs. The other pool's released nodes are only
+// reused if this pool has none of its own
+void ShipPool::adopt(ShipPool& other){
+    if (other.m_slabs == nullptr)
+        return;
+
+    // Adopted nodes need counts as soon as either pool carries them
+    if (m_counted || other.m_counted) {
+        enableCounts();
+        other.enableCounts();
+    }
+
+    if (m_slabs == nullptr) {
+        m_slabs = other.m_slabs;
+        m_used = other.m_used;
+    }
+    else {
+        // The adopted slabs go behind the current one, which keeps handing out nodes
+        Slab* last = other.m_slabs;
+        while (last->m_next != nullptr)
+            last = last->m_next;
+
+        last->m_next = m_slabs->m_next;
+        m_slabs->m_next = other.m_slabs;
+    }
+    if (m_free == nullptr)
+        m_free = other.m_free;
+    m_slabCount += other.m_slabCount;
+
+    other.m_slabs = nullptr;
+    other.m_used = 0;
+    other.m_free = nullptr;
+    other.m_slabCount = 0;
+}
+
+// Deallocates every slab at once, all nodes handed out become invalid
+void ShipPool::clear(){
+    while (m_slabs != nullptr) {
+        Slab* next = m_slabs->m_next;
+        delete[] m_slabs->m_ships;
+        delete[] m_slabs->m_counts;
+        delete m_slabs;
+        m_slabs = next;
+    }
+    m_used = 0;
+    m_free = nullptr;
+    m_slabCount = 0;
+}
+
+// Gives every node of the pool, and of every later slab, SHIPCLASSES counts for the
+// subtree aggregates. Pools of fleets without aggregates never pay for them
+void ShipPool::enableCounts(){
+    if (m_counted)
+        return;
+
+    m_counted = true;
+    for (Slab* slab = m_slabs; slab != nullptr; slab = slab->m_next)
+        addCounts(slab);
+}
+
+// Allocates the counts of a slab and hands every node its share
+void ShipPool::addCounts(Slab* slab){
+    slab->m_counts = new int[slab->m_capacity * SHIPCLASSES];
+    for (int i = 0; i < slab->m_capacity; i++)
+        slab->m_ships[i].m_counts = slab->m_counts + i * SHIPCLASSES;
+}
+
+// Creates an empty index
+ShipIndex::ShipIndex() : m_next(new int[IDCOUNT]), m_previous(new int[IDCOUNT]){
+    clear();
+}
+
+ShipIndex::~ShipIndex(){
+    delete[] m_next;
+    delete[] m_previous;
+}
+
+// Links a ship at the front of the list of its type and state
+void ShipIndex::add(const Ship& ship){
+    int offset = ship.getID() - MINID;
+    int& head = m_head[ship.getType()][ship.getState()];
+    m_previous[offset] = -1;
+    m_next[offset] = head;
+    if (head != -1)
+        m_previous[head] = offset;
+
+    head = offset;
+    m_count[ship.getType()][ship.getState()]++;
+}
+
+// Unlinks a ship from the list of its type and state
+void ShipIndex::remove(const Ship& ship){
+    int offset = ship.getID() - MINID;
+    if (m_previous[offset] != -1)
+        m_next[m_previous[offset]] = m_next[offset];
+
+    else
+        m_head[ship.getType()][ship.getState()] = m_next[offset];
+
+    if (m_next[offset] != -1)
+        m_previous[m_next[offset]] = m_previous[offset];
+
+    m_count[ship.getType()][ship.getState()]--;
+}
+
+// Empties every list, the slots of the old entries are simply abandoned
+void ShipIndex::clear(){
+    for (int type = 0; type < 5; type++) {
+        for (int state = 0; state < 2; state++) {
+            m_head[type][state] = -1;
+            m_count[type][state] = 0;
+        }
+    }
+}
+
+// Returns the number of ships with the given type and state
+int ShipIndex::count(SHIPTYPE type, STATE state) const{
+    return m_count[type][state];
+}
+
+// Copies up to maxShips ships of the given type and state into ships, returns how many
+int ShipIndex::list(SHIPTYPE type, STATE state, Ship* ships, int maxShips) const{
+    int count = 0;
+    for (int offset = m_head[type][state]; offset != -1 && count < maxShips; offset = m_next[offset])
+        ships[count++] = Ship(MINID + offset, type, state);
+    return count;
+}
@@ -2,16 +2,27 @@
 #ifndef FLEET_H
 #define FLEET_H
 #include <iostream>
+#include <iterator>
+#include <cstdint>
+#include <mutex>
 using namespace std;
 class Grader;//this class is for grading purposes, no need to do anything
 class Tester;//this is your tester class, you add your test functions in this class
 class Fleet;
 enum STATE {ALIVE, LOST};   // possible states for a ship
 enum SHIPTYPE {CARGO, TELESCOPE, COMMUNICATOR, FUELCARRIER, ROBOCARRIER};
-enum TREETYPE {NONE, BST, AVL, SPLAY};
+enum TREETYPE {NONE, BST, AVL, SPLAY, DENSE};
+enum DUPLICATE {KEEPLEFT, KEEPRIGHT, MERGESTATE}; // how set operations resolve a ship in both fleets
 const int MINID = 10000;    // min ship ID
 const int MAXID = 99999;    // max ship ID
+const int IDCOUNT = MAXID - MINID + 1;      // number of possible ship IDs
+const int DENSEWORDS = (IDCOUNT + 63) / 64; // bitmap words covering every possible ID
+const int SHIPCLASSES = 10;                 // number of type and state combinations
+const int PARALLELCUTOFF = 4096;            // subtrees smaller than this stay on one thread
+const int FLEETFILEVERSION = 1;             // format version written by Fleet::save
 #define DEFAULT_HEIGHT 0
+#define DEFAULT_SIZE 1
+#define DEFAULT_REFS 1
 #define DEFAULT_ID 0
 #define DEFAULT_TYPE CARGO
 #define DEFAULT_STATE ALIVE
@@ -19,6 +30,7 @@ const int MAXID = 99999;    // max ship ID
 class Ship{
     public:
     friend class Fleet;
+    friend class ShipPool;
     friend class Grader;
     friend class Tester;
     Ship(int id, SHIPTYPE type = DEFAULT_TYPE, STATE state = DEFAULT_STATE)
@@ -26,6 +38,9 @@ class Ship{
             m_left = nullptr;
             m_right = nullptr;
             m_height = DEFAULT_HEIGHT;
+            m_size = DEFAULT_SIZE;
+            m_refs = DEFAULT_REFS;
+            m_counts = nullptr;
         }
     Ship(){
         m_id = DEFAULT_ID;
@@ -34,6 +49,9 @@ class Ship{
         m_left = nullptr;
         m_right = nullptr;
         m_height = DEFAULT_HEIGHT;
+        m_size = DEFAULT_SIZE;
+        m_refs = DEFAULT_REFS;
+        m_counts = nullptr;
     }
     int getID() const {return m_id;}
     STATE getState() const {return m_state;}
@@ -63,55 +81,347 @@ class Ship{
         ;
     }
     int getHeight() const {return m_height;}
+    int getSize() const {return m_size;}
     Ship* getLeft() const {return m_left;}
     Ship* getRight() const {return m_right;}
     void setID(const int id){m_id=id;}
     void setState(STATE state){m_state=state;}
     void setType(SHIPTYPE type){m_type=type;}
     void setHeight(int height){m_height=height;}
+    void setSize(int size){m_size=size;}
     void setLeft(Ship* left){m_left=left;}
     void setRight(Ship* right){m_right=right;}
     private:
     int m_id;
     SHIPTYPE m_type;
     STATE m_state;
+    int m_refs;     //the number of links to this node from trees and fleet versions sharing it
     Ship* m_left;  //the pointer to the left child in the BST
     Ship* m_right; //the pointer to the right child in the BST
     int m_height;   //the height of this node in the BST
+    int m_size;     //the number of nodes in the subtree rooted at this node
+    int* m_counts;  //the type and state counts of the subtree, owned by the pool slot of this node
+
+    // Turns a pooled node into a fresh node holding ship, keeping the counts of its slot
+    void reset(const Ship& ship){
+        int* counts = m_counts;
+        *this = Ship(ship.m_id, ship.m_type, ship.m_state);
+        m_counts = counts;
+    }
+};
+// Slab allocator for the nodes of one fleet, its snapshots and the fleets split from
+// it. Ships are handed out from large slabs by bumping an index, released ships are
+// kept on a free list linked through their left pointers and reused before the slab
+// grows. The pool lives as long as any fleet version using it. Once counting is
+// enabled every slab carries SHIPCLASSES counts per node for the aggregates.
+class ShipPool{
+    public:
+    ShipPool();
+    ~ShipPool();
+    ShipPool(const ShipPool&) = delete;
+    ShipPool& operator=(const ShipPool&) = delete;
+    Ship* allocate(const Ship& ship);
+    void release(Ship* ship);
+    void reserve(int count);
+    Ship* allocateBlock(int count);
+    void adopt(ShipPool& other);
+    void clear();
+    void enableCounts();
+    void addUser() {m_users++;}
+    int removeUser() {return --m_users;}
+    int getUsers() const {return m_users;}
+    int getSlabCount() const {return m_slabCount;}
+    private:
+    struct Slab{
+        Ship* m_ships;  // the nodes of this slab
+        int m_capacity; // the number of nodes in m_ships
+        int* m_counts;  // SHIPCLASSES counts for every node, nullptr unless counting
+        Slab* m_next;   // the previously allocated slab
+    };
+    Slab* m_slabs;  // the most recently allocated slab, new ships come from here
+    int m_used;     // the number of ships handed out from m_slabs
+    Ship* m_free;   // released ships waiting to be reused
+    int m_slabCount;// the number of slabs currently allocated
+    int m_users;    // the number of fleet versions allocating from this pool
+    bool m_counted; // true if the slabs carry counts for the aggregates
+
+    void addCounts(Slab* slab);
+};
+// Secondary index of a fleet by type and state. Every possible ID has a slot in
+// two arrays that link the ships of the same type and state into a list, so
+// adding and removing a ship is O(1), counting is O(1) and listing the k ships
+// of one type and state is O(k), whatever the size of the fleet.
+class ShipIndex{
+    public:
+    ShipIndex();
+    ~ShipIndex();
+    ShipIndex(const ShipIndex&) = delete;
+    ShipIndex& operator=(const ShipIndex&) = delete;
+    void add(const Ship& ship);
+    void remove(const Ship& ship);
+    void clear();
+    int count(SHIPTYPE type, STATE state) const;
+    int list(SHIPTYPE type, STATE state, Ship* ships, int maxShips) const;
+    private:
+    int* m_next;        // the offset of the next ship in the same list, -1 at the end
+    int* m_previous;    // the offset of the previous ship in the same list, -1 at the start
+    int m_head[5][2];   // the first offset of every type and state list, -1 if empty
+    int m_count[5][2];  // the length of every type and state list
 };
 class Fleet{
     public:
     friend class Grader;
     friend class Tester;
+    // Bidirectional iterator over the ships in ID order. It keeps the path from
+    // the root to the current node on a stack allocated once by begin() or
+    // lower_bound(), end() has none until it is decremented, so neither stepping
+    // nor comparing with end() allocates (postfix steps copy the stack, prefer
+    // prefix). Any change to the fleet, including find() on a SPLAY fleet,
+    // invalidates its iterators
+    class const_iterator{
+        public:
+        typedef bidirectional_iterator_tag iterator_category;
+        typedef Ship value_type;
+        typedef ptrdiff_t difference_type;
+        typedef const Ship* pointer;
+        typedef const Ship& reference;
+        const_iterator();
+        const_iterator(const const_iterator& rhs);
+        ~const_iterator();
+        const_iterator & operator=(const const_iterator & rhs);
+        const Ship& operator*() const;
+        const Ship* operator->() const;
+        const_iterator & operator++();
+        const_iterator operator++(int);
+        const_iterator & operator--();
+        const_iterator operator--(int);
+        bool operator==(const const_iterator & rhs) const;
+        bool operator!=(const const_iterator & rhs) const;
+        private:
+        friend class Fleet;
+        friend class Tester;
+        const Fleet* m_fleet;// the fleet being iterated
+        Ship** m_stack;      // the nodes from the root down to the current one, empty at end()
+        int m_depth;         // the number of nodes on m_stack
+        int m_capacity;      // the number of nodes m_stack can hold
+        int m_offset;        // DENSE: current ID - MINID, IDCOUNT at end()
+        Ship m_ship;         // DENSE: copy of the current ship
+
+        const_iterator(const Fleet* fleet);
+        void reserveStack();
+        void pushLeftSpine(Ship* node);
+        void pushRightSpine(Ship* node);
+    };
     Fleet();
     Fleet(TREETYPE type);
+    Fleet(const Fleet & rhs);
+    Fleet(Fleet && rhs) noexcept;
     ~Fleet();
     const Fleet & operator=(const Fleet & rhs);
+    const Fleet & operator=(Fleet && rhs) noexcept;
+    void swap(Fleet & other) noexcept;
+    Fleet snapshot() const;
     void clear();
     TREETYPE getType() const;
     void setType(TREETYPE type);
     void insert(const Ship& ship);
+    void insertBatch(const Ship* ships, size_t n);
+    template <class ForwardIterator>
+    void insertBatch(ForwardIterator first, ForwardIterator last);
+    void mergeSortedBatch(const Ship* ships, size_t n);
     void remove(int id);
+    void removeRange(int lo, int hi);
+    void removeBatch(const int* ids, size_t n);
+    bool find(int id, Ship& ship);
+    bool contains(int id) const;
+    bool peek(int id, Ship& ship) const;
+    const_iterator begin() const;
+    const_iterator end() const;
+    const_iterator lower_bound(int id) const;
+    int size() const;
+    int rank(int id) const;
+    bool select(int k, Ship& ship) const;
+    int countInRange(int lo, int hi) const;
+    void setThreads(int threads);
+    int getThreads() const;
+    bool validate() const;
+    void setIndexed(bool indexed);
+    bool isIndexed() const;
+    int count(SHIPTYPE type, STATE state) const;
+    int countByType(SHIPTYPE type) const;
+    int countByState(STATE state) const;
+    int listShips(SHIPTYPE type, STATE state, Ship* ships, int maxShips) const;
+    void setAggregated(bool aggregated);
+    bool isAggregated() const;
+    void aggregateRange(int lo, int hi, int counts[5][2]) const;
+    void split(int id, Fleet& right, bool sharePool = false);
+    void join(Fleet& right);
+    void unionWith(const Fleet& other, DUPLICATE policy = KEEPLEFT);
+    void intersectWith(const Fleet& other, DUPLICATE policy = KEEPLEFT);
+    void differenceWith(const Fleet& other);
+    bool save(const string& path) const;
+    bool load(const string& path);
     void dumpTree() const;
     private:
     Ship* m_root;  // the root of the BST
     TREETYPE m_type;// the type of tree
+    ShipPool* m_pool;// the allocator owning every node of the tree, shared with snapshots, nullptr until first used
+    Ship*** m_path;  // links from m_root down to the node being inserted or removed
+    int m_pathCapacity;// the number of links m_path can hold
+    uint64_t* m_present;      // DENSE: one bit per possible ID, set if the ship exists
+    unsigned char* m_shipData;// DENSE: type and state of every possible ID, 4 bits each
+    int m_denseSize;          // DENSE: the number of ships
+    ShipIndex* m_index;       // the type and state index, nullptr unless enabled
+    bool m_aggregated;        // true if the nodes keep the type and state counts of their subtrees
+    int m_threads;            // the number of threads bulk build, copy and validation may use
+
+    // State shared by the recursive calls of one set operation
+    struct SetOperation{
+        DUPLICATE m_policy; // how ships in both fleets are resolved
+        mutex* m_lock;      // guards the pool and the index while threads run, nullptr on one thread
+    };
 
     // ***************************************************
     // Any private helper functions must be declared here!
-    Ship* imbalance(Ship* node);
-
     void updateHeights(Ship* node);
 
-    void clearHelper(Ship* root);
+    void rebuildBalanced(Ship** link);
+
+    void limitHeight(Ship** link);
 
-    void rotationAVL();
+    int treeToVine(Ship* pseudoRoot);
 
-    void rotationSPLAY(Ship* shipNode);
+    void compress(Ship* pseudoRoot, int count);
+
+    void rotationSPLAY(int depth);
+
+    void splay(Ship** rootLink, int id);
+
+    Ship* splayJoin(Ship* left, Ship* right);
 
     Ship* assignmentOperatorHelper(Ship* otherNode);
+
+    void copyTree(Ship* source, Ship* block, int threads);
+
+    void copyNode(Ship* source, Ship* copy);
+
+    bool validateTree(Ship* root, int lo, int hi, int threads) const;
+
+    bool validateNode(Ship* node, int lo, int hi) const;
+
+    Ship* linkTree(Ship** nodes, int first, int last, int threads = 1);
+
+    Ship* buildTree(const Fleet& other);
+
+    Ship* joinTrees(Ship* left, Ship* key, Ship* right);
+
+    Ship* joinLeft(Ship* left, Ship* key, Ship* right);
+
+    Ship* joinRight(Ship* left, Ship* key, Ship* right);
+
+    Ship* join2(Ship* left, Ship* right);
+
+    Ship* splitLast(Ship* root, Ship*& last);
+
+    void splitTree(Ship* root, int id, Ship*& less, Ship*& found, Ship*& greater);
+
+    Ship* unionTrees(Ship* a, Ship* b, const SetOperation& operation, int threads);
+
+    Ship* intersectTrees(Ship* a, Ship* b, const SetOperation& operation, int threads);
+
+    Ship* differenceTrees(Ship* a, Ship* b, const SetOperation& operation, int threads);
+
+    Ship* removeSorted(Ship* root, const int* ids, int count, const SetOperation& operation, int threads);
+
+    void keepDuplicate(Ship* node, const Ship& other, const SetOperation& operation);
+
+    void discardTree(Ship* root, bool indexed, const SetOperation& operation);
+
+    unique_lock<mutex> setLock(const SetOperation& operation) const;
+
+    void denseKeep(const Ship& ship, const Ship& other, DUPLICATE policy);
+
+    int flattenTree(Ship** nodes);
+
+    Ship* linkPreorder(Ship* block, int count);
+
+    Ship* unshare(Ship** link);
+
+    void unshareAll(Ship** link);
+
+    void releaseTree();
+
+    ShipPool* pool();
+
+    void releaseNodes(Ship* root);
+
+    void allocateDense();
+
+    void copyDense(const Fleet& other);
+
+    void releaseDense();
+
+    bool denseInsert(const Ship& ship);
+
+    bool densePeek(int id, Ship& ship) const;
+
+    void treeToDense();
+
+    void denseToTree();
+
+    void dumpDense() const;
+
+    int nextDense(int offset) const;
+
+    int previousDense(int offset) const;
+
+    void indexAdd(const Ship& ship);
+
+    void indexRemove(const Ship& ship);
+
+    void indexTree(Ship* root, bool add);
+
+    const int* aggregate(Ship* node) const;
+
+    void updateAggregate(Ship* node);
+
+    void aggregateBelow(int id, int* counts) const;
+
+    int height(Ship* node) const;
+
+    int subtreeSize(Ship* node) const;
+
+    void updateNode(Ship* node);
+
+    Ship* rotateLeft(Ship* node);
+
+    Ship* rotateRight(Ship* node);
+
+    Ship* rebalance(Ship* node);
+
+    void recordLink(int depth, Ship** link);
+
+    void retracePath(int depth);
+
+    Ship* findNode(int id) const;
     // ***************************************************
 
-    void dump(Ship* aShip) const;//helper for recursive traversal
+    void dump(Ship* aShip) const;//helper for in-order traversal
 };
+
+// Inserts every ship of an iterator range, see insertBatch(const Ship*, size_t)
+template <class ForwardIterator>
+void Fleet::insertBatch(ForwardIterator first, ForwardIterator last){
+    size_t n = 0;
+    for (ForwardIterator it = first; it != last; ++it)
+        n++;
+
+    Ship* ships = new Ship[n];
+    size_t i = 0;
+    for (ForwardIterator it = first; it != last; ++it)
+        ships[i++] = *it;
+
+    insertBatch(ships, n);
+    delete[] ships;
+}
 #endif
\ No newline at end of file
@@ -0,0 +1,174 @@
+// UMBC - CMSC 341 - Spring 2025 - Proj2
+#include "lockingfleet.h"
+
+// Constructor
+// Initializes an empty fleet, the sentinel holds an ID below every valid one
+LockingFleet::LockingFleet() : m_head(Ship(MINID - 1)), m_size(0){
+}
+
+// Destructor
+// Deletes every node with an explicit stack, no other thread may use the fleet
+LockingFleet::~LockingFleet(){
+    int depth = 0;
+    int capacity = 64;
+    Node** stack = new Node*[capacity];
+    if (m_head.m_left != nullptr)
+        stack[depth++] = m_head.m_left;
+
+    while (depth > 0) {
+        Node* node = stack[--depth];
+        if (depth + 2 > capacity) {
+            Node** grown = new Node*[capacity * 2];
+            for (int i = 0; i < depth; i++)
+                grown[i] = stack[i];
+            delete[] stack;
+            stack = grown;
+            capacity *= 2;
+        }
+        if (node->m_left != nullptr)
+            stack[depth++] = node->m_left;
+        if (node->m_right != nullptr)
+            stack[depth++] = node->m_right;
+        delete node;
+    }
+    delete[] stack;
+}
+
+// Inserts a ship, returns false if the ID is out of range or already in the fleet
+bool LockingFleet::insert(const Ship& ship){
+    if (ship.getID() < MINID || ship.getID() > MAXID)
+        return false;
+
+    Node** link;
+    Node* parent = lockParent(ship.getID(), link);
+    if (*link != nullptr) {
+        (*link)->m_lock.unlock();
+        parent->m_lock.unlock();
+        return false;
+    }
+
+    *link = new Node(ship);
+    m_size++;
+    parent->m_lock.unlock();
+    return true;
+}
+
+// Removes a ship by ID, returns false if it is not in the fleet.
+// A leaf is unlinked. Any other node takes over the ship of a leaf below it, whose
+// offset shares the node's path bits; the leaf is found by continuing hand over hand,
+// so searches still in that subtree stay ahead of us
+bool LockingFleet::remove(int id){
+    if (id < MINID || id > MAXID)
+        return false;
+
+    Node** link;
+    Node* parent = lockParent(id, link);
+    Node* node = *link;
+    if (node == nullptr) {
+        parent->m_lock.unlock();
+        return false;
+    }
+
+    if (node->m_left == nullptr && node->m_right == nullptr) {
+        *link = nullptr;
+        node->m_lock.unlock();
+        parent->m_lock.unlock();
+        delete node;
+    }
+    else {
+        // A child subtree cannot move up a level, its IDs would be sent by the wrong bits
+        Node* leafParent = node;
+        Node** leafLink = (node->m_left != nullptr) ? &node->m_left : &node->m_right;
+        Node* leaf = *leafLink;
+        leaf->m_lock.lock();
+        while (leaf->m_left != nullptr || leaf->m_right != nullptr) {
+            Node** next = (leaf->m_left != nullptr) ? &leaf->m_left : &leaf->m_right;
+            (*next)->m_lock.lock();
+            if (leafParent != node)
+                leafParent->m_lock.unlock();
+            leafParent = leaf;
+            leafLink = next;
+            leaf = *next;
+        }
+
+        node->m_ship = Ship(leaf->m_ship.getID(), leaf->m_ship.getType(), leaf->m_ship.getState());
+        *leafLink = nullptr;
+        leaf->m_lock.unlock();
+        if (leafParent != node)
+            leafParent->m_lock.unlock();
+        node->m_lock.unlock();
+        parent->m_lock.unlock();
+        delete leaf;
+    }
+    m_size--;
+    return true;
+}
+
+// Returns true if a ship with the given ID is in the fleet
+bool LockingFleet::contains(int id) const{
+    Ship ship;
+    return peek(id, ship);
+}
+
+// Copies the ship with the given ID into ship, returns false if not found
+bool LockingFleet::peek(int id, Ship& ship) const{
+    if (id < MINID || id > MAXID)
+        return false;
+
+    Node** link;
+    Node* parent = lockParent(id, link);
+    bool found = *link != nullptr;
+    if (found) {
+        ship = (*link)->m_ship;
+        (*link)->m_lock.unlock();
+    }
+    parent->m_lock.unlock();
+    return found;
+}
+
+// Returns the number of ships
+int LockingFleet::size() const{
+    return m_size;
+}
+
+// Prints the tree nested like Fleet::dumpTree, without heights. No other thread
+// may change the fleet meanwhile
+void LockingFleet::dumpTree() const{
+    dump(m_head.m_left);
+    cout << endl;
+}
+
+// Walks down hand over hand to the link where id is or would be, taking the bits of
+// its offset from the highest. Returns the node holding that link locked, and the
+// node at the link too if there is one. A node as deep as there are bits matches them
+// all, so the walk never runs out of bits for an ID in range
+LockingFleet::Node* LockingFleet::lockParent(int id, Node**& link) const{
+    Node* parent = const_cast<Node*>(&m_head);
+    parent->m_lock.lock();
+    link = &parent->m_left;
+    int bit = LOCKINGBITS - 1;
+    while (*link != nullptr) {
+        Node* node = *link;
+        node->m_lock.lock();
+        if (node->m_ship.getID() == id)
+            break;
+
+        parent->m_lock.unlock();
+        parent = node;
+        link = (((id - MINID) >> bit) & 1) ? &node->m_right : &node->m_left;
+        bit--;
+    }
+    return parent;
+}
+
+// Prints a subtree as (left id right), recursion is bounded by LOCKINGBITS + 1 levels
+void LockingFleet::dump(const Node* node) const{
+    if (node == nullptr)
+        return;
+
+    cout << "(";
+    dump(node->m_left);
+    cout << node->m_ship.getID();
+    dump(node->m_right);
+    cout << ")";
+}
@@ -0,0 +1,50 @@
+// UMBC - CMSC 341 - Spring 2025 - Proj2
+#ifndef LOCKINGFLEET_H
+#define LOCKINGFLEET_H
+#include "fleet.h"
+#include <atomic>
+#include <mutex>
+
+const int LOCKINGBITS = 17; // bits of an ID offset from MINID, 2^17 > IDCOUNT
+
+// Concurrent fleet for many writers. Every node has its own lock and every
+// operation walks down hand over hand, locking a child before letting go of its
+// parent, so threads working in different ID regions only meet near the root and
+// no thread can overtake another on the same path. The tree is a digital search
+// tree: a node at depth d sends an ID left or right by bit LOCKINGBITS - 1 - d of
+// its offset, so no path is longer than LOCKINGBITS + 1 nodes whatever order the
+// IDs arrive in, sorted ingest included, and nothing is ever rotated. In exchange
+// an in-order walk does not visit the IDs in order.
+class LockingFleet{
+    public:
+    friend class Grader;
+    friend class Tester;
+    LockingFleet();
+    LockingFleet(const LockingFleet&) = delete;
+    LockingFleet& operator=(const LockingFleet&) = delete;
+    ~LockingFleet();
+    bool insert(const Ship& ship);
+    bool remove(int id);
+    bool contains(int id) const;
+    bool peek(int id, Ship& ship) const;
+    int size() const;
+    void dumpTree() const;
+    private:
+    struct Node{
+        Node(const Ship& ship) : m_ship(ship.getID(), ship.getType(), ship.getState()),
+                                 m_left(nullptr), m_right(nullptr) {}
+        Ship m_ship;    // the ID, type and state of the ship
+        Node* m_left;   // the subtree of smaller IDs
+        Node* m_right;  // the subtree of larger IDs
+        mutex m_lock;   // held while the node or its links are read or changed
+    };
+    Node m_head;            // sentinel above the root, the root is its left child
+    atomic<int> m_size;     // the number of ships
+
+    // ***************************************************
+    // Any private helper functions must be declared here!
+    Node* lockParent(int id, Node**& link) const;
+    void dump(const Node* node) const;
+    // ***************************************************
+};
+#endif
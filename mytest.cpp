@@ -1,8 +1,20 @@
 #include "fleet.h"
+#include "compactfleet.h"
+#include "concurrentfleet.h"
+#include "lockingfleet.h"
+#include "shardedfleet.h"
 #include <math.h>
+#include <ctime>
 #include <algorithm>
 #include <random>
 #include <vector>
+#include <sstream>
+#include <thread>
+#include <atomic>
+#include <chrono>
+#include <fstream>
+#include <cstdio>
+#include <climits>
 
 enum RANDOM {UNIFORMINT, UNIFORMREAL, NORMAL, SHUFFLE};
 class Random {
@@ -155,6 +167,66 @@ class Tester {
         bool testAssignmentOperatorNormalCase();
         // Tests assignment operator for the error case (empty tree assignment)
         bool testAssignmentOperatorErrorCase();
+        // Measures AVL insert/remove time at two fleet sizes, per-op cost must grow logarithmically
+        bool testAVLPerformance();
+        // Measures splay insert/remove time at two fleet sizes, per-op cost must grow logarithmically
+        bool testSplayPerformance();
+        // Tests that find splays the accessed node to the root of a splay tree
+        bool testFindSplaysNode();
+        // Tests that contains and peek find every ship without restructuring the tree
+        bool testPeekDoesNotRestructure();
+        // Tests that removing from a splay tree deletes the ships and keeps heights accurate
+        bool testSplayRemove();
+        // Counts heap allocations of the node pool against one allocation per ship, also under churn
+        bool testPoolAllocations();
+        // Tests that the compact AVL storage builds the same tree as Fleet in under half the space
+        bool testCompactFleetMatchesAVL();
+        // Tests DENSE insert, remove and lookup over the full ID range and conversions to and from AVL
+        bool testDenseMode();
+        // Tests bulk loading of unsorted, sorted and duplicate ships into empty and existing fleets
+        bool testInsertBatch();
+        // Times converting a 90k-node sorted-insert BST to AVL, the result must be balanced
+        bool testConvertToAVL();
+        // Tests that a BST fed MINID..MAXID in order can be searched, edited, copied, dumped and cleared
+        bool testDegenerateBSTIsStackSafe();
+        // Tests forward, backward and lower_bound iteration in ID order for every fleet type
+        bool testIterators();
+        // Tests size, rank, select and countInRange against a sorted list in every fleet type
+        bool testOrderStatistics();
+        // Tests that the type and state index agrees with a full traversal through every kind of change
+        bool testShipIndex();
+        // Measures indexed queries at two fleet sizes, the cost must not grow with the fleet
+        bool testIndexPerformance();
+        // Tests that aggregateRange with subtree aggregates matches a walk of the range for every tree type
+        bool testAggregateRange();
+        // Tests copy and move construction and assignment and swap, copying must not write to the console
+        bool testCopyAndMove();
+        // Tests that snapshots share the tree in O(1) and changes to any version never show through to others
+        bool testSnapshots();
+        // Tests that readers always see a consistent concurrent fleet while a writer changes it
+        bool testConcurrentFleet();
+        // Measures concurrent fleet lookup throughput from 1 thread up to the number of cores
+        bool testConcurrentThroughput();
+        // Stress tests the locking fleet with many writers against sequential models
+        bool testLockingFleet();
+        // Tests that the thread pool runs every index of a loop exactly once, loop after loop
+        bool testThreadPool();
+        // Tests that a sharded fleet routes, batches and visits ships like a plain fleet
+        bool testShardedFleet();
+        // Measures a mixed workload on a sharded fleet from 1 thread up to the number of cores
+        bool testShardedThroughput();
+        // Tests and times batch build, deep copy and validation on any number of threads
+        bool testParallelBulkOperations();
+        // Tests split, join, union, intersection and difference against an array model
+        bool testSetOperations();
+        // Tests removeRange on every tree type against the remaining ships
+        bool testRemoveRange();
+        // Tests removeBatch with unsorted, duplicate and out of range IDs on any number of threads
+        bool testRemoveBatch();
+        // Tests mergeSortedBatch against insert on every tree type and times it against insertBatch
+        bool testMergeSortedBatch();
+        // Tests save and load round trips, the exact tree shape and rejected files
+        bool testSaveAndLoad();
 
     private:
         // Recursive helper function to verify BST property
@@ -167,6 +239,34 @@ class Tester {
         bool findShip(Ship* root, int shipID);
         // Detects for an imbalance in AVL tree by checking balance factor
         bool checkImbalance(Ship* root);
+        // Returns the average time in seconds of one insert or remove in a fleet of the given size
+        double timeFleetOperations(TREETYPE type, const vector<int>& ids, int size, bool& valid);
+        // Recursive helper function that checks if a fleet tree and a compact tree are identical
+        void checkIfCompactIdentical(Ship* root, const CompactFleet& compact, uint32_t node, bool& identical);
+        // Recursive helper function that counts the ships of a tree
+        int countShips(Ship* root);
+        // Recursive helper function that verifies if the subtree size is accurate at each node
+        void checkSizes(Ship* node, bool& ifSizesCorrect);
+        // Helper function that times indexed type and state queries on a fleet of a given size
+        double timeIndexQueries(const vector<int>& ids, int size, bool& valid);
+        // Helper function that checks if two sets of type and state counts are equal
+        bool sameCounts(const int first[5][2], const int second[5][2]);
+        // Helper function that checks if a fleet holds exactly the given ships in ID order
+        bool checkShips(const Fleet& fleet, const vector<Ship>& ships);
+        // Helper function that collects the nodes of a tree in pre-order
+        void collectNodes(Ship* root, vector<Ship*>& nodes);
+        // Helper function that times lookups from a number of threads, returns lookups per second
+        double timeConcurrentLookups(ConcurrentFleet& fleet, const vector<int>& ids, int threads, bool& valid);
+        // Helper function that checks the bit paths of a locking fleet, counts its nodes and measures its height
+        bool checkLockingTree(LockingFleet::Node* root, int path, int depth, int& count, int& height);
+        // Helper function that inserts ids[first..last) from a number of threads, returns the seconds taken
+        double timeLockingInserts(LockingFleet& fleet, const vector<int>& ids, int first, int last, int threads);
+        // Helper function that computes the expected ships of a set operation in ID order
+        vector<Ship> expectedSetOperation(const vector<Ship>& left, const vector<Ship>& right, int operation, DUPLICATE policy);
+        // Helper function that checks the ships, validity, counts and aggregates of a fleet
+        bool checkSetOperation(const Fleet& fleet, const vector<Ship>& expected);
+        // Helper function that times a batch insert with mergeSortedBatch or insertBatch in microseconds
+        long timeBatchInsert(const vector<Ship>& existing, const vector<Ship>& batch, bool merge);
 };
 
 // Test whether the AVL tree remains balanced after multiple insertions
@@ -464,6 +564,1996 @@ bool Tester::testAssignmentOperatorErrorCase() {
     return fleetCopy.m_root == nullptr;
 }
 
+// Measures AVL insert/remove time at two fleet sizes, per-op cost must grow logarithmically
+bool Tester::testAVLPerformance() {
+    Random idGen(MINID, MAXID, SHUFFLE);
+    vector<int> uniqueIDs;
+    idGen.getShuffle(uniqueIDs);
+
+    bool valid = true;
+    const int smallSize = 10000;
+    const int largeSize = 80000;
+    double smallTime = timeFleetOperations(AVL, uniqueIDs, smallSize, valid);
+    double largeTime = timeFleetOperations(AVL, uniqueIDs, largeSize, valid);
+
+    cout << "(" << smallSize << " ships: " << int(smallTime * 1e9) << " ns/op, "
+         << largeSize << " ships: " << int(largeTime * 1e9) << " ns/op) ";
+
+    // log(80000)/log(10000) is about 1.23, a linear cost would be 8 times slower
+    return valid && largeTime < smallTime * 4;
+}
+
+// Measures splay insert/remove time at two fleet sizes, per-op cost must grow logarithmically
+bool Tester::testSplayPerformance() {
+    Random idGen(MINID, MAXID, SHUFFLE);
+    vector<int> uniqueIDs;
+    idGen.getShuffle(uniqueIDs);
+
+    bool valid = true;
+    const int smallSize = 10000;
+    const int largeSize = 80000;
+    double smallTime = timeFleetOperations(SPLAY, uniqueIDs, smallSize, valid);
+    double largeTime = timeFleetOperations(SPLAY, uniqueIDs, largeSize, valid);
+
+    cout << "(" << smallSize << " ships: " << int(smallTime * 1e9) << " ns/op, "
+         << largeSize << " ships: " << int(largeTime * 1e9) << " ns/op) ";
+
+    // Amortized O(log n) splaying, a cost quadratic in the depth would be far slower
+    return valid && largeTime < smallTime * 4;
+}
+
+// Returns the average time in seconds of one insert or remove in a fleet of the given size
+double Tester::timeFleetOperations(TREETYPE type, const vector<int>& ids, int size, bool& valid) {
+    Fleet fleet(type);
+    clock_t start = clock();
+
+    for (int i = 0; i < size; i++)
+        fleet.insert(Ship(ids[i], static_cast<SHIPTYPE>(i % 5), ALIVE));
+
+    for (int i = 0; i < size; i += 2)
+        fleet.remove(ids[i]);
+
+    clock_t stop = clock();
+
+    bool ifHeightsCorrect = true;
+    bool ifSizesCorrect = true;
+    checkHeights(fleet.m_root, ifHeightsCorrect);
+    checkSizes(fleet.m_root, ifSizesCorrect);
+    valid = valid && ifHeightsCorrect && ifSizesCorrect && checkBSTProperty(fleet.m_root, MINID, MAXID);
+    if (type == AVL)
+        valid = valid && !checkImbalance(fleet.m_root);
+
+    return double(stop - start) / CLOCKS_PER_SEC / (size + size / 2);
+}
+
+// Tests that find splays the accessed node to the root of a splay tree
+bool Tester::testFindSplaysNode() {
+    Fleet fleet(SPLAY);
+    Random idGen(MINID, MAXID, SHUFFLE);
+    vector<int> uniqueIDs;
+    idGen.getShuffle(uniqueIDs);
+
+    for (int i = 0; i < 300; i++)
+        fleet.insert(Ship(uniqueIDs[i], static_cast<SHIPTYPE>(i % 5), (i % 2 == 0) ? ALIVE : LOST));
+
+    bool ifSplayed = true;
+    for (int i = 0; i < 300; i += 7) {
+        Ship ship;
+        if (!fleet.find(uniqueIDs[i], ship) || ship.getID() != uniqueIDs[i] ||
+            ship.getType() != static_cast<SHIPTYPE>(i % 5) || fleet.m_root->getID() != uniqueIDs[i])
+            ifSplayed = false;
+    }
+
+    // A missing ID is not found but the tree must stay valid
+    Ship missing;
+    bool notFound = !fleet.find(uniqueIDs[300], missing) && !fleet.find(MAXID + 1, missing);
+
+    bool ifHeightsCorrect = true;
+    checkHeights(fleet.m_root, ifHeightsCorrect);
+    return ifSplayed && notFound && ifHeightsCorrect && checkBSTProperty(fleet.m_root, MINID, MAXID);
+}
+
+// Tests that contains and peek find every ship without restructuring the tree
+bool Tester::testPeekDoesNotRestructure() {
+    Fleet fleet(SPLAY);
+    Random idGen(MINID, MAXID, SHUFFLE);
+    vector<int> uniqueIDs;
+    idGen.getShuffle(uniqueIDs);
+
+    for (int i = 0; i < 300; i++)
+        fleet.insert(Ship(uniqueIDs[i], CARGO, ALIVE));
+
+    Ship* root = fleet.m_root;
+    bool allFound = true;
+    for (int i = 0; i < 300; i++) {
+        Ship ship;
+        if (!fleet.contains(uniqueIDs[i]) || !fleet.peek(uniqueIDs[i], ship) || ship.getID() != uniqueIDs[i])
+            allFound = false;
+    }
+
+    return allFound && !fleet.contains(uniqueIDs[300]) && fleet.m_root == root;
+}
+
+// Tests that removing from a splay tree deletes the ships and keeps heights accurate
+bool Tester::testSplayRemove() {
+    Fleet fleet(SPLAY);
+    Random idGen(MINID, MAXID, SHUFFLE);
+    vector<int> uniqueIDs;
+    idGen.getShuffle(uniqueIDs);
+
+    for (int i = 0; i < 300; i++)
+        fleet.insert(Ship(uniqueIDs[i], CARGO, ALIVE));
+
+    // Remove every other ship plus an ID that was never inserted
+    for (int i = 0; i < 300; i += 2)
+        fleet.remove(uniqueIDs[i]);
+    fleet.remove(uniqueIDs[300]);
+
+    bool removed = true;
+    for (int i = 0; i < 300; i++) {
+        if (findShip(fleet.m_root, uniqueIDs[i]) != (i % 2 == 1))
+            removed = false;
+    }
+
+    // Removing the only node empties the tree
+    Fleet single(SPLAY);
+    single.insert(Ship(MINID));
+    single.remove(MINID);
+
+    bool ifHeightsCorrect = true;
+    checkHeights(fleet.m_root, ifHeightsCorrect);
+    return removed && ifHeightsCorrect && single.m_root == nullptr &&
+           checkBSTProperty(fleet.m_root, MINID, MAXID);
+}
+
+// Counts heap allocations of the node pool against one allocation per ship, also under churn
+bool Tester::testPoolAllocations() {
+    Fleet fleet(AVL);
+    Random idGen(MINID, MAXID, SHUFFLE);
+    vector<int> uniqueIDs;
+    idGen.getShuffle(uniqueIDs);
+
+    const int size = 50000;
+    for (int i = 0; i < size; i++)
+        fleet.insert(Ship(uniqueIDs[i], CARGO, ALIVE));
+
+    int slabsAfterInsert = fleet.m_pool->getSlabCount();
+
+    // Replace half of the fleet, released nodes must be reused
+    for (int i = 0; i < size; i += 2)
+        fleet.remove(uniqueIDs[i]);
+    for (int i = size; i < size + size / 2; i++)
+        fleet.insert(Ship(uniqueIDs[i], CARGO, ALIVE));
+
+    int slabsAfterChurn = fleet.m_pool->getSlabCount();
+
+    // Each slab costs two allocations, the old code paid one per inserted ship
+    cout << "(" << size + size / 2 << " inserts: " << 2 * slabsAfterChurn << " allocations, was "
+         << size + size / 2 << ") ";
+
+    fleet.clear();
+    return slabsAfterInsert < size / 1000 && slabsAfterChurn == slabsAfterInsert &&
+           fleet.m_pool->getSlabCount() == 0 && fleet.m_root == nullptr;
+}
+
+// Tests that the compact AVL storage builds the same tree as Fleet in under half the space
+bool Tester::testCompactFleetMatchesAVL() {
+    Fleet fleet(AVL);
+    CompactFleet compact;
+    Random idGen(MINID, MAXID, SHUFFLE);
+    vector<int> uniqueIDs;
+    idGen.getShuffle(uniqueIDs);
+
+    for (int i = 0; i < 20000; i++) {
+        Ship ship(uniqueIDs[i], static_cast<SHIPTYPE>(i % 5), (i % 3 == 0) ? LOST : ALIVE);
+        fleet.insert(ship);
+        compact.insert(ship);
+    }
+    for (int i = 0; i < 20000; i += 2) {
+        fleet.remove(uniqueIDs[i]);
+        compact.remove(uniqueIDs[i]);
+    }
+
+    bool identical = true;
+    checkIfCompactIdentical(fleet.m_root, compact, compact.m_root, identical);
+
+    // Type and state survive the packing, copies are independent
+    Ship ship;
+    CompactFleet copy(compact);
+    compact.clear();
+    bool packed = copy.peek(uniqueIDs[1], ship) && ship.getType() == TELESCOPE && ship.getState() == ALIVE &&
+                  copy.peek(uniqueIDs[3], ship) && ship.getType() == FUELCARRIER && ship.getState() == LOST &&
+                  !copy.contains(uniqueIDs[0]) && copy.size() == 10000 && !compact.contains(uniqueIDs[1]);
+
+    return identical && packed && 2 * sizeof(CompactFleet::Node) <= sizeof(Ship);
+}
+
+// Helper function to check if a fleet tree and a compact tree are identical
+void Tester::checkIfCompactIdentical(Ship* root, const CompactFleet& compact, uint32_t node, bool& identical) {
+    if (!identical || (root == nullptr && node == NILINDEX))
+        return;
+
+    if (root == nullptr || node == NILINDEX || root->getID() != compact.getID(node) ||
+        root->getHeight() != compact.height(node)) {
+        identical = false;
+        return;
+    }
+
+    checkIfCompactIdentical(root->getLeft(), compact, compact.m_nodes[node].m_left, identical);
+    checkIfCompactIdentical(root->getRight(), compact, compact.m_nodes[node].m_right, identical);
+}
+
+// Tests DENSE insert, remove and lookup over the full ID range and conversions to and from AVL
+bool Tester::testDenseMode() {
+    Random idGen(MINID, MAXID, SHUFFLE);
+    vector<int> uniqueIDs;
+    idGen.getShuffle(uniqueIDs);
+
+    // Time a nearly full fleet in DENSE and AVL mode
+    double seconds[2];
+    TREETYPE types[2] = {DENSE, AVL};
+    bool valid = true;
+    for (int t = 0; t < 2; t++) {
+        Fleet fleet(types[t]);
+        clock_t start = clock();
+        for (int i = 0; i < IDCOUNT; i++)
+            fleet.insert(Ship(uniqueIDs[i], static_cast<SHIPTYPE>(i % 5), (i % 2 == 0) ? ALIVE : LOST));
+        for (int i = 0; i < IDCOUNT; i += 10)
+            fleet.remove(uniqueIDs[i]);
+        for (int i = 0; i < IDCOUNT; i++)
+            valid = valid && fleet.contains(uniqueIDs[i]) == (i % 10 != 0);
+        seconds[t] = double(clock() - start) / CLOCKS_PER_SEC;
+    }
+    cout << "(DENSE " << int(seconds[0] * 1000) << " ms, AVL " << int(seconds[1] * 1000) << " ms) ";
+
+    // Convert a tree to DENSE and back, type and state must survive and the tree must be balanced
+    Fleet fleet(BST);
+    for (int i = 0; i < 1000; i++)
+        fleet.insert(Ship(uniqueIDs[i], static_cast<SHIPTYPE>(i % 5), (i % 2 == 0) ? ALIVE : LOST));
+    fleet.setType(DENSE);
+    fleet.insert(Ship(uniqueIDs[0], CARGO, ALIVE)); // duplicate is ignored
+    fleet.remove(uniqueIDs[1]);
+
+    bool converted = fleet.m_root == nullptr;
+    fleet.setType(AVL);
+    for (int i = 0; i < 1000; i++) {
+        Ship ship;
+        bool found = fleet.peek(uniqueIDs[i], ship);
+        if (found != (i != 1) || (found && (ship.getType() != static_cast<SHIPTYPE>(i % 5) ||
+                                            ship.getState() != ((i % 2 == 0) ? ALIVE : LOST))))
+            converted = false;
+    }
+
+    bool ifHeightsCorrect = true;
+    checkHeights(fleet.m_root, ifHeightsCorrect);
+    return valid && converted && ifHeightsCorrect && !checkImbalance(fleet.m_root) &&
+           fleet.m_present == nullptr && seconds[0] < seconds[1];
+}
+
+// Tests bulk loading of unsorted, sorted and duplicate ships into empty and existing fleets
+bool Tester::testInsertBatch() {
+    Random idGen(MINID, MAXID, SHUFFLE);
+    vector<int> uniqueIDs;
+    idGen.getShuffle(uniqueIDs);
+
+    // Unsorted batch with a duplicate and an out of range ID, the first duplicate wins
+    vector<Ship> ships;
+    for (int i = 0; i < 50000; i++)
+        ships.push_back(Ship(uniqueIDs[i], static_cast<SHIPTYPE>(i % 5), ALIVE));
+    ships.push_back(Ship(uniqueIDs[0], CARGO, LOST));
+    ships.push_back(Ship(MAXID + 1));
+
+    Fleet fleet(AVL);
+    clock_t start = clock();
+    fleet.insertBatch(ships.begin(), ships.end());
+    double batchTime = double(clock() - start) / CLOCKS_PER_SEC;
+
+    Fleet oneByOne(AVL);
+    start = clock();
+    for (size_t i = 0; i < ships.size(); i++)
+        oneByOne.insert(ships[i]);
+    double insertTime = double(clock() - start) / CLOCKS_PER_SEC;
+    cout << "(batch " << int(batchTime * 1000) << " ms, inserts " << int(insertTime * 1000) << " ms) ";
+
+    Ship ship;
+    bool loaded = fleet.peek(uniqueIDs[0], ship) && ship.getState() == ALIVE &&
+                  countShips(fleet.m_root) == 50000;
+
+    // A sorted batch merged into an existing SPLAY fleet keeps the old ships
+    Fleet splay(SPLAY);
+    for (int i = 0; i < 100; i++)
+        splay.insert(Ship(uniqueIDs[i], TELESCOPE, LOST));
+
+    vector<int> sortedIDs(uniqueIDs.begin() + 50, uniqueIDs.begin() + 1050);
+    sort(sortedIDs.begin(), sortedIDs.end());
+    Ship* sortedShips = new Ship[sortedIDs.size()];
+    for (size_t i = 0; i < sortedIDs.size(); i++)
+        sortedShips[i] = Ship(sortedIDs[i], CARGO, ALIVE);
+    splay.insertBatch(sortedShips, sortedIDs.size());
+    delete[] sortedShips;
+
+    bool merged = countShips(splay.m_root) == 1050 && splay.peek(uniqueIDs[60], ship) &&
+                  ship.getType() == TELESCOPE && splay.peek(uniqueIDs[1000], ship) && ship.getType() == CARGO;
+
+    bool ifHeightsCorrect = true;
+    checkHeights(fleet.m_root, ifHeightsCorrect);
+    checkHeights(splay.m_root, ifHeightsCorrect);
+    return loaded && merged && ifHeightsCorrect && !checkImbalance(fleet.m_root) &&
+           !checkImbalance(splay.m_root) && checkBSTProperty(fleet.m_root, MINID, MAXID) &&
+           checkBSTProperty(splay.m_root, MINID, MAXID);
+}
+
+// Times converting a 90k-node sorted-insert BST to AVL, the result must be balanced
+bool Tester::testConvertToAVL() {
+    // Descending inserts into a splay tree build the same right vine as ascending
+    // inserts into a BST, but in linear time
+    Fleet fleet(SPLAY);
+    for (int id = MAXID; id >= MINID; id--)
+        fleet.insert(Ship(id, static_cast<SHIPTYPE>(id % 5), ALIVE));
+    fleet.setType(BST);
+
+    bool degenerate = fleet.m_root->getID() == MINID && fleet.m_root->getHeight() == IDCOUNT - 1;
+
+    clock_t start = clock();
+    fleet.setType(AVL);
+    double seconds = double(clock() - start) / CLOCKS_PER_SEC;
+    cout << "(" << IDCOUNT << " ships: " << int(seconds * 1000) << " ms) ";
+
+    bool ifHeightsCorrect = true;
+    checkHeights(fleet.m_root, ifHeightsCorrect);
+    return degenerate && ifHeightsCorrect && !checkImbalance(fleet.m_root) &&
+           checkBSTProperty(fleet.m_root, MINID, MAXID) && countShips(fleet.m_root) == IDCOUNT &&
+           fleet.m_root->getHeight() == 16;
+}
+
+// Tests that a BST fed MINID..MAXID in order can be searched, edited, copied, dumped and cleared
+bool Tester::testDegenerateBSTIsStackSafe() {
+    // In-order inserts into a splay tree build the same 90k-deep vine a BST builds,
+    // but in linear instead of quadratic time
+    Fleet fleet(SPLAY);
+    for (int id = MINID; id <= MAXID; id++)
+        fleet.insert(Ship(id, static_cast<SHIPTYPE>(id % 5), ALIVE));
+    fleet.setType(BST);
+    bool degenerate = fleet.m_root->getID() == MAXID && fleet.m_root->getHeight() == IDCOUNT - 1;
+
+    // Remove and re-insert the deepest ship, heights along the whole chain must follow
+    fleet.remove(MINID);
+    bool shrunk = fleet.m_root->getHeight() == IDCOUNT - 2 && !fleet.contains(MINID);
+    fleet.insert(Ship(MINID, CARGO, LOST));
+    Ship ship;
+    bool grown = fleet.m_root->getHeight() == IDCOUNT - 1 && fleet.peek(MINID, ship) && ship.getState() == LOST;
+
+    // Copy and dump the vine with the output captured
+    Fleet copy;
+    copy = fleet;
+    stringstream output;
+    streambuf* console = cout.rdbuf(output.rdbuf());
+    copy.dumpTree();
+    cout.rdbuf(console);
+
+    string dump = output.str();
+    bool copied = copy.m_root->getHeight() == IDCOUNT - 1 && dump.size() > 2 * size_t(IDCOUNT) &&
+                  dump.compare(0, 12, "((((((((((((") == 0 && dump.back() == ')';
+
+    // Walk the copied vine to verify every height without recursion
+    int expectedHeight = IDCOUNT - 1;
+    for (Ship* node = copy.m_root; node != nullptr; node = node->getLeft()) {
+        if (node->getHeight() != expectedHeight-- || node->getRight() != nullptr)
+            copied = false;
+    }
+
+    copy.setType(AVL);
+    bool ifHeightsCorrect = true;
+    checkHeights(copy.m_root, ifHeightsCorrect);
+
+    fleet.clear();
+    copy.clear();
+    return degenerate && shrunk && grown && copied && ifHeightsCorrect && fleet.m_root == nullptr;
+}
+
+// Tests forward, backward and lower_bound iteration in ID order for every fleet type
+bool Tester::testIterators() {
+    Random idGen(MINID, MAXID, SHUFFLE);
+    vector<int> uniqueIDs;
+    idGen.getShuffle(uniqueIDs);
+
+    vector<int> sortedIDs(uniqueIDs.begin(), uniqueIDs.begin() + 2000);
+    sort(sortedIDs.begin(), sortedIDs.end());
+
+    bool ordered = true;
+    TREETYPE types[4] = {BST, AVL, SPLAY, DENSE};
+    for (int t = 0; t < 4; t++) {
+        Fleet fleet(types[t]);
+        for (int i = 0; i < 2000; i++)
+            fleet.insert(Ship(uniqueIDs[i], static_cast<SHIPTYPE>(uniqueIDs[i] % 5), ALIVE));
+
+        // Forward
+        size_t i = 0;
+        for (Fleet::const_iterator it = fleet.begin(); it != fleet.end(); ++it, i++) {
+            if (i >= sortedIDs.size() || it->getID() != sortedIDs[i] ||
+                (*it).getType() != static_cast<SHIPTYPE>(sortedIDs[i] % 5))
+                ordered = false;
+        }
+        ordered = ordered && i == sortedIDs.size() && distance(fleet.begin(), fleet.end()) == 2000;
+
+        // Only iterators that hold a position own a stack, comparing with end() is free
+        ordered = ordered && fleet.end().m_stack == nullptr &&
+                  (types[t] == DENSE || fleet.begin().m_stack != nullptr);
+
+        // Backward from end()
+        Fleet::const_iterator it = fleet.end();
+        for (size_t j = sortedIDs.size(); j-- > 0; ) {
+            --it;
+            if (it->getID() != sortedIDs[j])
+                ordered = false;
+        }
+        ordered = ordered && --it == fleet.end();
+
+        // lower_bound on a present ID, a missing ID, and past the last ID
+        Fleet::const_iterator present = fleet.lower_bound(sortedIDs[500]);
+        Fleet::const_iterator missing = fleet.lower_bound(sortedIDs[700] - 1);
+        if (sortedIDs[699] == sortedIDs[700] - 1)
+            missing++;
+        ordered = ordered && present->getID() == sortedIDs[500] && (++present)->getID() == sortedIDs[501] &&
+                  missing->getID() == sortedIDs[700] && fleet.lower_bound(sortedIDs.back() + 1) == fleet.end() &&
+                  fleet.lower_bound(MINID - 1) == fleet.begin();
+    }
+
+    // The 90k-deep vine is walked without recursion
+    Fleet vine(SPLAY);
+    for (int id = MINID; id <= MAXID; id++)
+        vine.insert(Ship(id));
+    int expected = MINID;
+    for (Fleet::const_iterator it = vine.begin(); it != vine.end(); ++it)
+        ordered = ordered && it->getID() == expected++;
+
+    Fleet empty(AVL);
+    return ordered && expected == MAXID + 1 && empty.begin() == empty.end();
+}
+
+// Tests size, rank, select and countInRange against a sorted list in every fleet type
+bool Tester::testOrderStatistics() {
+    Random idGen(MINID, MAXID, SHUFFLE);
+    vector<int> uniqueIDs;
+    idGen.getShuffle(uniqueIDs);
+
+    bool correct = true;
+    TREETYPE types[4] = {BST, AVL, SPLAY, DENSE};
+    for (int t = 0; t < 4; t++) {
+        Fleet fleet(types[t]);
+        for (int i = 0; i < 3000; i++)
+            fleet.insert(Ship(uniqueIDs[i], static_cast<SHIPTYPE>(i % 5), ALIVE));
+
+        // Remove a third of the ships and splay some others to the root
+        for (int i = 0; i < 3000; i += 3)
+            fleet.remove(uniqueIDs[i]);
+        Ship ship;
+        for (int i = 1; i < 3000; i += 17)
+            fleet.find(uniqueIDs[i], ship);
+
+        vector<int> sortedIDs;
+        for (int i = 0; i < 3000; i++) {
+            if (i % 3 != 0)
+                sortedIDs.push_back(uniqueIDs[i]);
+        }
+        sort(sortedIDs.begin(), sortedIDs.end());
+
+        int count = sortedIDs.size();
+        correct = correct && fleet.size() == count && !fleet.select(count, ship) && !fleet.select(-1, ship);
+        for (int k = 0; k < count; k += 7) {
+            correct = correct && fleet.select(k, ship) && ship.getID() == sortedIDs[k] &&
+                      fleet.rank(sortedIDs[k]) == k && fleet.rank(sortedIDs[k] + 1) == k + 1;
+        }
+
+        // Ranges with both, one and no ends in the fleet
+        for (int k = 0; k + 100 < count; k += 101) {
+            correct = correct && fleet.countInRange(sortedIDs[k], sortedIDs[k + 100]) == 101 &&
+                      fleet.countInRange(sortedIDs[k] + 1, sortedIDs[k + 100]) == 100 &&
+                      fleet.countInRange(sortedIDs[k + 100], sortedIDs[k]) == 0;
+        }
+        correct = correct && fleet.countInRange(MINID, MAXID) == count && fleet.rank(MAXID + 1) == count &&
+                  fleet.countInRange(MINID, INT_MAX) == count && fleet.countInRange(INT_MIN, INT_MAX) == count &&
+                  fleet.countInRange(sortedIDs[count / 2], INT_MAX) == count - count / 2;
+
+        bool ifSizesCorrect = true;
+        checkSizes(fleet.m_root, ifSizesCorrect);
+        correct = correct && ifSizesCorrect;
+    }
+    return correct;
+}
+
+// Helper function to check if the subtree sizes of nodes are accurate
+void Tester::checkSizes(Ship *node, bool& ifSizesCorrect) {
+    if (node != nullptr && ifSizesCorrect) {
+        checkSizes(node->getLeft(), ifSizesCorrect);
+        checkSizes(node->getRight(), ifSizesCorrect);
+
+        int leftSize = (node->getLeft() != nullptr) ? node->getLeft()->getSize() : 0;
+        int rightSize = (node->getRight() != nullptr) ? node->getRight()->getSize() : 0;
+
+        if (node->getSize() != leftSize + rightSize + 1)
+            ifSizesCorrect = false;
+    }
+}
+
+// Checks if two sets of type and state counts are equal
+bool Tester::sameCounts(const int first[5][2], const int second[5][2]) {
+    for (int type = 0; type < 5; type++) {
+        if (first[type][ALIVE] != second[type][ALIVE] || first[type][LOST] != second[type][LOST])
+            return false;
+    }
+    return true;
+}
+
+// Tests that the type and state index agrees with a full traversal for every tree type,
+// through inserts, removes, batches, conversions, clear and assignment
+bool Tester::testShipIndex() {
+    Random idGen(MINID, MAXID, SHUFFLE);
+    vector<int> uniqueIDs;
+    idGen.getShuffle(uniqueIDs);
+
+    bool correct = true;
+    TREETYPE types[4] = {BST, AVL, SPLAY, DENSE};
+    Ship* ships = new Ship[4000];
+    for (int t = 0; t < 4; t++) {
+        Fleet indexed(types[t]);
+        Fleet plain(types[t]);
+        // Half the ships are indexed on insert, the other half when the index is turned on
+        for (int i = 0; i < 1000; i++) {
+            Ship ship(uniqueIDs[i], static_cast<SHIPTYPE>(i % 5), (i % 3 == 0) ? LOST : ALIVE);
+            if (i == 500)
+                indexed.setIndexed(true);
+            indexed.insert(ship);
+            plain.insert(ship);
+        }
+        indexed.insert(Ship(uniqueIDs[0], TELESCOPE, ALIVE));
+        for (int i = 0; i < 1000; i += 4) {
+            indexed.remove(uniqueIDs[i]);
+            plain.remove(uniqueIDs[i]);
+        }
+        indexed.remove(uniqueIDs[0]);
+        for (int i = 1000; i < 2000; i++)
+            ships[i - 1000] = Ship(uniqueIDs[i], static_cast<SHIPTYPE>(i % 4), (i % 2 == 0) ? LOST : ALIVE);
+        indexed.insertBatch(ships, 1000);
+        plain.insertBatch(ships, 1000);
+        indexed.setType(types[(t + 1) % 4]);
+
+        Fleet copy;
+        copy = indexed;
+        correct = correct && indexed.isIndexed() && copy.isIndexed() && !plain.isIndexed();
+
+        // Every count and list must match the traversal of the unindexed fleet
+        int total = 0;
+        for (int type = CARGO; type <= ROBOCARRIER; type++) {
+            for (int state = ALIVE; state <= LOST; state++) {
+                SHIPTYPE shipType = static_cast<SHIPTYPE>(type);
+                STATE shipState = static_cast<STATE>(state);
+                int count = plain.count(shipType, shipState);
+                int listed = copy.listShips(shipType, shipState, ships, 4000);
+                correct = correct && indexed.count(shipType, shipState) == count && listed == count;
+                for (int i = 0; i < listed; i++) {
+                    Ship ship;
+                    correct = correct && plain.peek(ships[i].getID(), ship) &&
+                              ship.getType() == shipType && ship.getState() == shipState;
+                }
+                total += count;
+            }
+            correct = correct && indexed.countByType(static_cast<SHIPTYPE>(type)) ==
+                                 plain.countByType(static_cast<SHIPTYPE>(type));
+        }
+        correct = correct && total == plain.size() &&
+                  indexed.countByState(LOST) + indexed.countByState(ALIVE) == total &&
+                  indexed.countByState(LOST) == plain.countByState(LOST) &&
+                  indexed.listShips(CARGO, ALIVE, ships, 3) == 3;
+
+        indexed.clear();
+        indexed.setType(types[t]);
+        indexed.insert(Ship(uniqueIDs[0], FUELCARRIER, LOST));
+        correct = correct && indexed.countByState(ALIVE) == 0 && indexed.count(FUELCARRIER, LOST) == 1;
+        indexed.setIndexed(false);
+        correct = correct && !indexed.isIndexed() && indexed.count(FUELCARRIER, LOST) == 1;
+    }
+    delete[] ships;
+    return correct;
+}
+
+// Measures indexed queries at two fleet sizes, the cost must not grow with the fleet
+bool Tester::testIndexPerformance() {
+    Random idGen(MINID, MAXID, SHUFFLE);
+    vector<int> uniqueIDs;
+    idGen.getShuffle(uniqueIDs);
+
+    bool valid = true;
+    const int smallSize = 10000;
+    const int largeSize = 80000;
+    double smallTime = timeIndexQueries(uniqueIDs, smallSize, valid);
+    double largeTime = timeIndexQueries(uniqueIDs, largeSize, valid);
+
+    cout << "(" << smallSize << " ships: " << int(smallTime * 1e9) << " ns/query, "
+         << largeSize << " ships: " << int(largeTime * 1e9) << " ns/query) ";
+
+    // A query that traversed the fleet would be 8 times slower
+    return valid && largeTime < smallTime * 3;
+}
+
+double Tester::timeIndexQueries(const vector<int>& ids, int size, bool& valid) {
+    Fleet fleet(AVL);
+    fleet.setIndexed(true);
+    for (int i = 0; i < size; i++)
+        fleet.insert(Ship(ids[i], static_cast<SHIPTYPE>(i % 5), (i % 2 == 0) ? ALIVE : LOST));
+
+    const int queries = 50000;
+    Ship ships[50];
+    int total = 0;
+    clock_t start = clock();
+
+    // Every query counts one type and state and lists its first 50 ships
+    for (int i = 0; i < queries; i++) {
+        SHIPTYPE type = static_cast<SHIPTYPE>(i % 5);
+        STATE state = (i % 2 == 0) ? ALIVE : LOST;
+        total += fleet.count(type, state) + fleet.listShips(type, state, ships, 50);
+        total += ships[i % 50].getID() % 2;
+    }
+
+    clock_t stop = clock();
+    valid = valid && total >= queries * (size / 10 + 50);
+
+    return double(stop - start) / CLOCKS_PER_SEC / queries;
+}
+
+// Tests that aggregateRange with subtree aggregates matches a walk of the range for every
+// tree type, through inserts, removes, splaying, batches, conversions and assignment
+bool Tester::testAggregateRange() {
+    Random idGen(MINID, MAXID, SHUFFLE);
+    vector<int> uniqueIDs;
+    idGen.getShuffle(uniqueIDs);
+    Random rangeGen(MINID, MAXID, UNIFORMINT);
+
+    bool correct = true;
+    TREETYPE types[4] = {BST, AVL, SPLAY, DENSE};
+    Ship* ships = new Ship[1000];
+    for (int t = 0; t < 4; t++) {
+        Fleet aggregated(types[t]);
+        Fleet plain(types[t]);
+        // Half the ships are added before the aggregates are turned on
+        for (int i = 0; i < 2000; i++) {
+            Ship ship(uniqueIDs[i], static_cast<SHIPTYPE>(i % 5), (i % 3 == 0) ? LOST : ALIVE);
+            if (i == 1000)
+                aggregated.setAggregated(true);
+            aggregated.insert(ship);
+            plain.insert(ship);
+        }
+        Ship ship;
+        for (int i = 0; i < 2000; i += 5) {
+            aggregated.remove(uniqueIDs[i]);
+            plain.remove(uniqueIDs[i]);
+            aggregated.find(uniqueIDs[i + 1], ship);
+        }
+        int expected[5][2], counts[5][2], copied[5][2];
+        plain.aggregateRange(MINID, MAXID, expected);
+        aggregated.aggregateRange(MINID, MAXID, counts);
+        correct = correct && sameCounts(expected, counts);
+        for (int i = 2000; i < 3000; i++)
+            ships[i - 2000] = Ship(uniqueIDs[i], static_cast<SHIPTYPE>(i % 4), (i % 2 == 0) ? LOST : ALIVE);
+        aggregated.insertBatch(ships, 1000);
+        plain.insertBatch(ships, 1000);
+        aggregated.setType(types[(t + 1) % 4]);
+
+        bool ifSizesCorrect = true;
+        checkSizes(aggregated.m_root, ifSizesCorrect);
+        correct = correct && ifSizesCorrect && aggregated.isAggregated() && !plain.isAggregated();
+
+        Fleet copy;
+        copy = aggregated;
+
+        for (int i = 0; i < 300; i++) {
+            int lo = rangeGen.getRandNum();
+            int hi = (i % 10 == 0) ? MAXID : lo + rangeGen.getRandNum() % 20000;
+            plain.aggregateRange(lo, hi, expected);
+            aggregated.aggregateRange(lo, hi, counts);
+            copy.aggregateRange(lo, hi, copied);
+
+            int total = 0;
+            for (int type = 0; type < 5; type++)
+                total += expected[type][ALIVE] + expected[type][LOST];
+            correct = correct && sameCounts(expected, counts) && sameCounts(expected, copied) &&
+                      total == plain.countInRange(lo, hi);
+        }
+
+        aggregated.aggregateRange(MINID, MAXID, counts);
+        correct = correct && counts[CARGO][LOST] == plain.count(CARGO, LOST);
+        aggregated.aggregateRange(MAXID, MINID, counts);
+        correct = correct && counts[CARGO][LOST] == 0;
+
+        // Open-ended ranges up to INT_MAX
+        int lo = uniqueIDs[500];
+        plain.aggregateRange(lo, MAXID, expected);
+        aggregated.aggregateRange(lo, INT_MAX, counts);
+        correct = correct && sameCounts(expected, counts);
+        plain.aggregateRange(MINID, MAXID, expected);
+        aggregated.aggregateRange(INT_MIN, INT_MAX, counts);
+        correct = correct && sameCounts(expected, counts);
+    }
+
+    // The counts live beside the nodes in the pool, which only carries them once a
+    // fleet using it turns aggregates on; versions sharing nodes keep their own counts
+    Fleet small(AVL);
+    for (int i = 0; i < 10; i++)
+        small.insert(Ship(uniqueIDs[i], static_cast<SHIPTYPE>(i % 5), ALIVE));
+    correct = correct && small.m_root->m_counts == nullptr;
+    small.setAggregated(true);
+    Fleet version = small.snapshot();
+    version.setAggregated(true);
+    version.insert(Ship(uniqueIDs[10], CARGO, LOST));
+    small.remove(uniqueIDs[0]);
+    int smallCounts[5][2], versionCounts[5][2];
+    small.aggregateRange(MINID, MAXID, smallCounts);
+    version.aggregateRange(MINID, MAXID, versionCounts);
+    correct = correct && small.m_root->m_counts != nullptr && smallCounts[CARGO][ALIVE] == 1 &&
+              smallCounts[CARGO][LOST] == 0 && versionCounts[CARGO][ALIVE] == 2 &&
+              versionCounts[CARGO][LOST] == 1 && version.validate() && small.validate();
+    delete[] ships;
+    return correct;
+}
+
+// Tests the copy constructor, move construction and assignment and swap, and that
+// copying never writes to the console
+bool Tester::testCopyAndMove() {
+    Random idGen(MINID, MAXID, SHUFFLE);
+    vector<int> uniqueIDs;
+    idGen.getShuffle(uniqueIDs);
+
+    Fleet original(AVL);
+    original.setIndexed(true);
+    for (int i = 0; i < 500; i++)
+        original.insert(Ship(uniqueIDs[i], static_cast<SHIPTYPE>(i % 5), ALIVE));
+
+    // Copies are deep and identical, and silent
+    stringstream output;
+    streambuf* console = cout.rdbuf(output.rdbuf());
+    Fleet copied(original);
+    Fleet assigned;
+    assigned = original;
+    cout.rdbuf(console);
+
+    bool identical = true;
+    checkIfIdentical(original.m_root, copied.m_root, identical);
+    checkIfIdentical(original.m_root, assigned.m_root, identical);
+    bool copiedOK = identical && output.str().empty() && copied.m_root != original.m_root &&
+                    copied.isIndexed() && copied.count(CARGO, ALIVE) == 100 && copied.getType() == AVL;
+
+    // Moving takes over the nodes and the pool themselves and leaves the source empty
+    // without a pool, so nothing is allocated
+    Ship* root = original.m_root;
+    ShipPool* pool = original.m_pool;
+    Fleet moved(std::move(original));
+    bool movedOK = moved.m_root == root && original.m_root == nullptr && original.size() == 0 &&
+                   moved.size() == 500 && moved.isIndexed() && !original.isIndexed() &&
+                   moved.m_pool == pool && original.m_pool == nullptr && Fleet(AVL).m_pool == nullptr;
+
+    Fleet target(SPLAY);
+    target.insert(Ship(uniqueIDs[600], CARGO, LOST));
+    target = std::move(moved);
+    movedOK = movedOK && target.m_root == root && moved.m_root == nullptr && moved.m_pool == nullptr &&
+              target.m_pool == pool && target.getType() == AVL &&
+              !target.contains(uniqueIDs[600]) && target.contains(uniqueIDs[0]);
+
+    // The moved-from fleet is still usable
+    moved.setType(BST);
+    moved.insert(Ship(uniqueIDs[600], CARGO, LOST));
+    movedOK = movedOK && moved.size() == 1 && moved.m_pool != nullptr;
+
+    target.swap(moved);
+    bool swapped = moved.m_root == root && target.size() == 1 && moved.size() == 500 &&
+                   target.getType() == BST && moved.getType() == AVL;
+
+    // Self assignment changes nothing, fleets can live in containers
+    Fleet& alias = moved;
+    moved = alias;
+    moved = std::move(alias);
+    vector<Fleet> fleets;
+    fleets.push_back(std::move(moved));
+    fleets.push_back(copied);
+    fleets.resize(10);
+    bool stored = fleets[0].m_root == root && fleets[0].size() == 500 && fleets[1].size() == 500;
+
+    return copiedOK && movedOK && swapped && stored;
+}
+
+// Tests that snapshots share the tree in O(1), that changes to a fleet or to any of its
+// versions copy only the path they touch and never show through to the others
+bool Tester::testSnapshots() {
+    Random idGen(MINID, MAXID, SHUFFLE);
+    vector<int> uniqueIDs;
+    idGen.getShuffle(uniqueIDs);
+
+    bool correct = true;
+    TREETYPE types[4] = {BST, AVL, SPLAY, DENSE};
+    for (int t = 0; t < 4; t++) {
+        Fleet fleet(types[t]);
+        fleet.setIndexed(true);
+        for (int i = 0; i < 2000; i++)
+            fleet.insert(Ship(uniqueIDs[i], static_cast<SHIPTYPE>(i % 5), (i % 2 == 0) ? ALIVE : LOST));
+
+        vector<Ship> before(fleet.begin(), fleet.end());
+        Fleet first = fleet.snapshot();
+        correct = correct && first.m_root == fleet.m_root && checkShips(first, before);
+
+        // One insert copies one path, every other node stays shared
+        if (types[t] != DENSE) {
+            vector<Ship*> shared;
+            collectNodes(first.m_root, shared);
+            sort(shared.begin(), shared.end());
+            fleet.insert(Ship(uniqueIDs[2000], CARGO, LOST));
+            vector<Ship*> nodes;
+            collectNodes(fleet.m_root, nodes);
+            int copied = 0;
+            for (size_t i = 0; i < nodes.size(); i++) {
+                if (!binary_search(shared.begin(), shared.end(), nodes[i]))
+                    copied++;
+            }
+            correct = correct && copied <= first.m_root->getHeight() + 2;
+        }
+        else
+            fleet.insert(Ship(uniqueIDs[2000], CARGO, LOST));
+
+        // Change the fleet in every way while the first version stays as it was
+        Ship ship;
+        for (int i = 0; i < 2000; i += 3) {
+            fleet.remove(uniqueIDs[i]);
+            fleet.find(uniqueIDs[i + 1], ship);
+        }
+        Fleet second = fleet.snapshot();
+        vector<Ship> middle(fleet.begin(), fleet.end());
+        Ship batch[500];
+        for (int i = 0; i < 500; i++)
+            batch[i] = Ship(uniqueIDs[3000 + i], TELESCOPE, ALIVE);
+        fleet.insertBatch(batch, 500);
+        fleet.setType(types[(t + 1) % 4]);
+        fleet.setType(types[t]);
+        int telescopes = 500;
+        for (size_t i = 0; i < middle.size(); i++) {
+            if (middle[i].getType() == TELESCOPE && middle[i].getState() == ALIVE)
+                telescopes++;
+        }
+        correct = correct && checkShips(first, before) && checkShips(second, middle) &&
+                  fleet.size() == int(middle.size()) + 500 && fleet.count(TELESCOPE, ALIVE) == telescopes &&
+                  !first.isIndexed();
+
+        // Versions are fleets of their own, changing one leaves the others alone
+        for (int i = 1; i < 2000; i += 3) {
+            second.remove(uniqueIDs[i]);
+            second.insert(Ship(uniqueIDs[4000 + i], FUELCARRIER, LOST));
+        }
+        correct = correct && checkShips(first, before) && second.size() == int(middle.size()) &&
+                  !second.contains(uniqueIDs[1]) && fleet.contains(uniqueIDs[1]);
+
+        bool ifHeightsCorrect = true;
+        bool ifSizesCorrect = true;
+        checkHeights(second.m_root, ifHeightsCorrect);
+        checkSizes(first.m_root, ifSizesCorrect);
+        checkSizes(fleet.m_root, ifSizesCorrect);
+        correct = correct && ifHeightsCorrect && ifSizesCorrect &&
+                  checkBSTProperty(second.m_root, MINID, MAXID);
+        if (types[t] == AVL)
+            correct = correct && !checkImbalance(second.m_root) && !checkImbalance(fleet.m_root);
+
+        // Many versions can pile up, and outlive the fleet they were taken from
+        Fleet* versions = new Fleet[50];
+        for (int i = 0; i < 50; i++) {
+            versions[i] = std::move(second.snapshot());
+            second.remove(uniqueIDs[4001 + 3 * i]);
+        }
+        Fleet copy;
+        copy = versions[10];
+        fleet.clear();
+        second.clear();
+        correct = correct && checkShips(first, before) && versions[0].size() == int(middle.size()) &&
+                  versions[49].size() == int(middle.size()) - 49 && copy.size() == versions[10].size();
+        delete[] versions;
+        correct = correct && checkShips(first, before);
+    }
+    return correct;
+}
+
+// Checks if a fleet holds exactly the given ships in ID order
+bool Tester::checkShips(const Fleet& fleet, const vector<Ship>& ships) {
+    if (fleet.size() != int(ships.size()))
+        return false;
+
+    size_t i = 0;
+    for (Fleet::const_iterator it = fleet.begin(); it != fleet.end(); ++it, i++) {
+        if (it->getID() != ships[i].getID() || it->getType() != ships[i].getType() ||
+            it->getState() != ships[i].getState())
+            return false;
+    }
+    return i == ships.size();
+}
+
+// Collects the nodes of a tree in pre-order
+void Tester::collectNodes(Ship* root, vector<Ship*>& nodes) {
+    if (root != nullptr) {
+        nodes.push_back(root);
+        collectNodes(root->getLeft(), nodes);
+        collectNodes(root->getRight(), nodes);
+    }
+}
+
+// Tests that readers always see a consistent fleet while a writer changes it, for
+// every tree type, including sampled splaying and lock-free reads of a snapshot
+bool Tester::testConcurrentFleet() {
+    Random idGen(MINID, MAXID, SHUFFLE);
+    vector<int> uniqueIDs;
+    idGen.getShuffle(uniqueIDs);
+
+    bool correct = true;
+    TREETYPE types[3] = {BST, AVL, SPLAY};
+    for (int t = 0; t < 3; t++) {
+        // The first 10000 ships stay, the next 10000 come and go, the rest never exist
+        ConcurrentFleet fleet(types[t], 4);
+        for (int i = 0; i < 20000; i++)
+            fleet.insert(Ship(uniqueIDs[i], static_cast<SHIPTYPE>(i % 5), ALIVE));
+        Ship* root = fleet.m_fleet.m_root;
+        Fleet snapshot = fleet.snapshot();
+
+        atomic<bool> done(false);
+        atomic<int> errors(0);
+        vector<thread> readers;
+        for (int r = 0; r < 3; r++) {
+            readers.emplace_back([&, r]() {
+                Ship ship;
+                for (int i = r; !done; i += 7) {
+                    int stay = i % 10000;
+                    if (!fleet.find(uniqueIDs[stay], ship) || ship.getType() != static_cast<SHIPTYPE>(stay % 5))
+                        errors++;
+                    if (fleet.contains(uniqueIDs[20000 + stay]) || fleet.size() < 10000)
+                        errors++;
+                }
+            });
+        }
+        readers.emplace_back([&]() {
+            while (!done) {
+                if (snapshot.size() != 20000 || !snapshot.contains(uniqueIDs[15000]))
+                    errors++;
+            }
+        });
+
+        for (int round = 0; round < 3; round++) {
+            for (int i = 10000; i < 20000; i++)
+                fleet.remove(uniqueIDs[i]);
+            for (int i = 10000; i < 20000; i++)
+                fleet.insert(Ship(uniqueIDs[i], static_cast<SHIPTYPE>(i % 5), LOST));
+        }
+        done = true;
+        for (size_t r = 0; r < readers.size(); r++)
+            readers[r].join();
+        fleet.release(snapshot);
+
+        bool ifHeightsCorrect = true;
+        bool ifSizesCorrect = true;
+        checkHeights(fleet.m_fleet.m_root, ifHeightsCorrect);
+        checkSizes(fleet.m_fleet.m_root, ifSizesCorrect);
+        correct = correct && errors == 0 && fleet.size() == 20000 && snapshot.size() == 0 &&
+                  fleet.count(CARGO, LOST) == 2000 && ifHeightsCorrect && ifSizesCorrect &&
+                  checkBSTProperty(fleet.m_fleet.m_root, MINID, MAXID);
+        if (types[t] == AVL)
+            correct = correct && !checkImbalance(fleet.m_fleet.m_root);
+
+        // Only one in four SPLAY lookups restructures the tree
+        if (types[t] == SPLAY) {
+            Ship ship;
+            root = fleet.m_fleet.m_root;
+            fleet.find(uniqueIDs[5], ship);
+            bool splayed = fleet.m_fleet.m_root != root;
+            root = fleet.m_fleet.m_root;
+            for (int i = 6; i < 9; i++)
+                fleet.find(uniqueIDs[i], ship);
+            correct = correct && splayed != (fleet.m_fleet.m_root != root);
+        }
+    }
+    return correct;
+}
+
+// Measures lookup throughput of a concurrent fleet from 1 thread up to the number of cores
+// (at least 4), lookups of a BST or AVL fleet share the reader lock
+bool Tester::testConcurrentThroughput() {
+    Random idGen(MINID, MAXID, SHUFFLE);
+    vector<int> uniqueIDs;
+    idGen.getShuffle(uniqueIDs);
+
+    bool valid = true;
+    int cores = thread::hardware_concurrency();
+    TREETYPE types[2] = {AVL, SPLAY};
+    for (int t = 0; t < 2; t++) {
+        ConcurrentFleet fleet(types[t]);
+        for (int i = 0; i < 80000; i++)
+            fleet.insert(Ship(uniqueIDs[i], static_cast<SHIPTYPE>(i % 5), ALIVE));
+
+        cout << "(" << (types[t] == AVL ? "AVL" : "SPLAY");
+        for (int threads = 1; threads <= cores || threads <= 4; threads *= 2) {
+            double rate = timeConcurrentLookups(fleet, uniqueIDs, threads, valid);
+            cout << ", " << threads << " threads: " << int(rate / 1e3) << "k/s";
+        }
+        cout << ") ";
+    }
+    return valid;
+}
+
+double Tester::timeConcurrentLookups(ConcurrentFleet& fleet, const vector<int>& ids, int threads, bool& valid) {
+    const int lookups = 400000;
+    atomic<int> missing(0);
+    vector<thread> workers;
+    chrono::steady_clock::time_point start = chrono::steady_clock::now();
+
+    // Every thread looks up its share of the ships, all of which are in the fleet
+    for (int w = 0; w < threads; w++) {
+        workers.emplace_back([&, w]() {
+            Ship ship;
+            for (int i = w; i < lookups; i += threads) {
+                if (!fleet.find(ids[i % 80000], ship))
+                    missing++;
+            }
+        });
+    }
+    for (int w = 0; w < threads; w++)
+        workers[w].join();
+
+    chrono::duration<double> elapsed = chrono::steady_clock::now() - start;
+    valid = valid && missing == 0;
+    return lookups / elapsed.count();
+}
+
+// Stress tests the locking fleet with many writers. Every thread owns an ID region where
+// each result must match its own sequential model, and all threads fight over a few
+// shared IDs where successful inserts and removes must alternate like in a sequential set.
+// Sorted ingest of every ID must keep the tree within the bits of an offset
+bool Tester::testLockingFleet() {
+    Random idGen(MINID, MAXID, SHUFFLE);
+    vector<int> uniqueIDs;
+    idGen.getShuffle(uniqueIDs);
+
+    const int threads = 4;
+    const int region = 5000;
+    const int shared = 64;
+    LockingFleet fleet;
+    atomic<int> mismatches(0);
+    vector<vector<bool> > models(threads, vector<bool>(region, false));
+    vector<vector<int> > inserted(threads, vector<int>(shared, 0));
+    vector<vector<int> > removed(threads, vector<int>(shared, 0));
+
+    vector<thread> workers;
+    for (int t = 0; t < threads; t++) {
+        workers.emplace_back([&, t]() {
+            mt19937 random(t);
+            for (int i = 0; i < 40000; i++) {
+                int operation = random() % 3;
+                if (i % 4 == 0) {
+                    // A shared ID, only the successful changes are counted
+                    int key = random() % shared;
+                    int id = uniqueIDs[threads * region + key];
+                    if (operation == 0 && fleet.insert(Ship(id)))
+                        inserted[t][key]++;
+                    else if (operation == 1 && fleet.remove(id))
+                        removed[t][key]++;
+                    else if (operation == 2)
+                        fleet.contains(id);
+                }
+                else {
+                    // An ID of this thread's region, the result must match the model
+                    int key = random() % region;
+                    int id = uniqueIDs[t * region + key];
+                    Ship ship;
+                    bool result;
+                    if (operation == 0) {
+                        result = fleet.insert(Ship(id, static_cast<SHIPTYPE>(key % 5), LOST));
+                        if (result != !models[t][key])
+                            mismatches++;
+                        models[t][key] = true;
+                    }
+                    else if (operation == 1) {
+                        result = fleet.remove(id);
+                        if (result != models[t][key])
+                            mismatches++;
+                        models[t][key] = false;
+                    }
+                    else {
+                        result = fleet.peek(id, ship);
+                        if (result != models[t][key] || (result && ship.getType() != static_cast<SHIPTYPE>(key % 5)))
+                            mismatches++;
+                    }
+                }
+            }
+        });
+    }
+    for (int t = 0; t < threads; t++)
+        workers[t].join();
+
+    // The final fleet must match the models
+    int expected = 0;
+    for (int t = 0; t < threads; t++) {
+        for (int key = 0; key < region; key++) {
+            if (fleet.contains(uniqueIDs[t * region + key]) != models[t][key])
+                mismatches++;
+            expected += models[t][key];
+        }
+    }
+    for (int key = 0; key < shared; key++) {
+        int balance = 0;
+        for (int t = 0; t < threads; t++)
+            balance += inserted[t][key] - removed[t][key];
+        if (balance != (fleet.contains(uniqueIDs[threads * region + key]) ? 1 : 0))
+            mismatches++;
+        expected += balance;
+    }
+
+    int count = 0;
+    int height;
+    bool valid = checkLockingTree(fleet.m_head.m_left, 0, 0, count, height) && count == expected &&
+                 fleet.size() == expected && mismatches == 0;
+
+    // Ordered ingest, every writer adding its own range in increasing ID order, stays
+    // within the bits of an offset; a plain BST would be as deep as a range is long
+    LockingFleet ordered;
+    vector<int> orderedIDs(IDCOUNT);
+    for (int i = 0; i < IDCOUNT; i++)
+        orderedIDs[i] = MINID + i;
+    timeLockingInserts(ordered, orderedIDs, 0, IDCOUNT, threads);
+    count = 0;
+    valid = valid && checkLockingTree(ordered.m_head.m_left, 0, 0, count, height) && count == IDCOUNT &&
+            ordered.size() == IDCOUNT && height <= LOCKINGBITS;
+    for (int i = 0; i < IDCOUNT; i += 2)
+        ordered.remove(MINID + i);
+    count = 0;
+    valid = valid && checkLockingTree(ordered.m_head.m_left, 0, 0, count, height) && count == IDCOUNT / 2 &&
+            ordered.size() == IDCOUNT / 2 && ordered.contains(MINID + 1) && !ordered.contains(MINID) &&
+            !ordered.remove(MINID - 1) && !ordered.remove(MAXID + 1);
+
+    // Inserts into disjoint regions, timed with one and with several writers
+    LockingFleet single, several;
+    double singleTime = timeLockingInserts(single, uniqueIDs, 0, 40000, 1);
+    double severalTime = timeLockingInserts(several, uniqueIDs, 0, 40000, threads);
+    cout << "(40000 inserts, 1 writer: " << int(singleTime * 1000) << " ms, " << threads
+         << " writers: " << int(severalTime * 1000) << " ms) ";
+
+    return valid && single.size() == 40000 && several.size() == 40000;
+}
+
+// Checks that every node of a locking fleet lies on the path of its offset bits, counts
+// the nodes and measures the height
+bool Tester::checkLockingTree(LockingFleet::Node* root, int path, int depth, int& count, int& height) {
+    if (root == nullptr) {
+        height = depth - 1;
+        return true;
+    }
+
+    // The highest depth bits of the offset must be the turns taken to get here
+    count++;
+    int id = root->m_ship.getID();
+    int leftHeight, rightHeight;
+    bool valid = id >= MINID && id <= MAXID && depth <= LOCKINGBITS && ((id - MINID) >> (LOCKINGBITS - depth)) == path &&
+                 checkLockingTree(root->m_left, path * 2, depth + 1, count, leftHeight) &&
+                 checkLockingTree(root->m_right, path * 2 + 1, depth + 1, count, rightHeight);
+    height = max(leftHeight, rightHeight);
+    return valid;
+}
+
+double Tester::timeLockingInserts(LockingFleet& fleet, const vector<int>& ids, int first, int last, int threads) {
+    vector<thread> workers;
+    chrono::steady_clock::time_point start = chrono::steady_clock::now();
+
+    // Every thread inserts its own contiguous share of the IDs
+    int share = (last - first) / threads;
+    for (int t = 0; t < threads; t++) {
+        int end = (t == threads - 1) ? last : first + (t + 1) * share;
+        workers.emplace_back([&, t, end]() {
+            for (int i = first + t * share; i < end; i++)
+                fleet.insert(Ship(ids[i]));
+        });
+    }
+    for (int t = 0; t < threads; t++)
+        workers[t].join();
+
+    chrono::duration<double> elapsed = chrono::steady_clock::now() - start;
+    return elapsed.count();
+}
+
+// Tests that the thread pool runs every index of a loop exactly once, loop after loop
+bool Tester::testThreadPool() {
+    bool correct = true;
+    int sizes[3] = {1, 2, 4};
+    for (int s = 0; s < 3; s++) {
+        ThreadPool pool(sizes[s]);
+        vector<atomic<int> > hits(1000);
+        for (int round = 0; round < 50; round++) {
+            for (int i = 0; i < 1000; i++)
+                hits[i] = 0;
+            pool.run(1000, [&](int i) {hits[i]++;});
+            for (int i = 0; i < 1000; i++)
+                correct = correct && hits[i] == 1;
+        }
+        pool.run(0, [&](int) {correct = false;});
+        correct = correct && pool.getThreads() == sizes[s];
+    }
+    return correct;
+}
+
+// Tests that a sharded fleet routes every ship to the shard of its ID range, runs batches
+// per shard and visits all ships in ID order, matching a plain fleet
+bool Tester::testShardedFleet() {
+    Random idGen(MINID, MAXID, SHUFFLE);
+    vector<int> uniqueIDs;
+    idGen.getShuffle(uniqueIDs);
+    Random rangeGen(MINID, MAXID, UNIFORMINT);
+
+    ShardedFleet sharded(AVL, 8, 4);
+    Fleet model(AVL);
+
+    // Batches with duplicates and IDs out of range, then single and batch removals
+    vector<Ship> batch;
+    for (int i = 0; i < 30000; i++)
+        batch.push_back(Ship(uniqueIDs[i % 25000], static_cast<SHIPTYPE>(i % 5), (i % 2 == 0) ? ALIVE : LOST));
+    batch.push_back(Ship(MAXID + 1));
+    batch.push_back(Ship(MINID - 1));
+    sharded.insertBatch(batch.data(), batch.size());
+    model.insertBatch(batch.data(), batch.size());
+    for (int i = 25000; i < 26000; i++) {
+        sharded.insert(Ship(uniqueIDs[i], ROBOCARRIER, LOST));
+        model.insert(Ship(uniqueIDs[i], ROBOCARRIER, LOST));
+        sharded.remove(uniqueIDs[i - 25000]);
+        model.remove(uniqueIDs[i - 25000]);
+    }
+    vector<int> removals(uniqueIDs.begin() + 5000, uniqueIDs.begin() + 10000);
+    removals.push_back(MAXID + 1);
+    sharded.removeBatch(removals.data(), removals.size());
+    for (size_t i = 0; i < removals.size(); i++)
+        model.remove(removals[i]);
+
+    // Every ship in ID order with its type and state
+    vector<Ship> visited;
+    sharded.forEach([&](const Ship& ship) {visited.push_back(ship);});
+    bool correct = sharded.size() == model.size() && checkShips(model, visited);
+
+    // Every shard holds its own range only
+    for (int i = 0; i < sharded.getShardCount(); i++)
+        sharded.m_shards[i]->forEach([&](const Ship& ship) {correct = correct && sharded.shardOf(ship.getID()) == i;});
+
+    for (int i = 0; i < 200; i++) {
+        int lo = rangeGen.getRandNum();
+        int hi = lo + rangeGen.getRandNum() % 30000;
+        correct = correct && sharded.countInRange(lo, hi) == model.countInRange(lo, hi);
+    }
+    Ship ship;
+    correct = correct && sharded.countInRange(MINID - 5, MAXID + 5) == model.size() &&
+              sharded.find(uniqueIDs[25500], ship) && ship.getType() == ROBOCARRIER &&
+              !sharded.peek(uniqueIDs[6000], ship) && !sharded.contains(MAXID + 1) &&
+              sharded.shardOf(MINID) == 0 && sharded.shardOf(MAXID) == 7;
+
+    sharded.clear();
+    return correct && sharded.size() == 0;
+}
+
+// Measures a mixed insert, lookup and remove workload on a sharded fleet from 1 thread up to
+// the number of cores (at least 4), every thread working on its own IDs
+bool Tester::testShardedThroughput() {
+    Random idGen(MINID, MAXID, SHUFFLE);
+    vector<int> uniqueIDs;
+    idGen.getShuffle(uniqueIDs);
+
+    bool valid = true;
+    int cores = thread::hardware_concurrency();
+    cout << "(";
+    for (int threads = 1; threads <= cores || threads <= 4; threads *= 2) {
+        ShardedFleet fleet(AVL, 16, threads);
+        atomic<int> errors(0);
+        atomic<int> removed(0);
+        vector<thread> workers;
+        chrono::steady_clock::time_point start = chrono::steady_clock::now();
+
+        // Insert, look up twice and remove every other ship of this thread's share
+        for (int w = 0; w < threads; w++) {
+            workers.emplace_back([&, w]() {
+                Ship ship;
+                for (int i = w; i < 80000; i += threads)
+                    fleet.insert(Ship(uniqueIDs[i]));
+                for (int i = w; i < 80000; i += threads) {
+                    if (!fleet.find(uniqueIDs[i], ship) || !fleet.contains(uniqueIDs[i]))
+                        errors++;
+                }
+                for (int i = w; i < 80000; i += 2 * threads, removed++)
+                    fleet.remove(uniqueIDs[i]);
+            });
+        }
+        for (int w = 0; w < threads; w++)
+            workers[w].join();
+
+        chrono::duration<double> elapsed = chrono::steady_clock::now() - start;
+        valid = valid && errors == 0 && fleet.size() == 80000 - removed;
+        cout << (threads > 1 ? ", " : "") << threads << " threads: "
+             << int((240000 + removed) / elapsed.count() / 1e3) << "k ops/s";
+    }
+    cout << ") ";
+    return valid;
+}
+
+// Tests that batch builds, deep copies and validation give the same results on any number
+// of threads, that validation catches a broken node, and times them from 1 thread up to
+// the number of cores (at least 4)
+bool Tester::testParallelBulkOperations() {
+    Random idGen(MINID, MAXID, SHUFFLE);
+    vector<int> uniqueIDs;
+    idGen.getShuffle(uniqueIDs);
+
+    // Every possible ID in order, a sorted batch builds in linear time
+    vector<Ship> ships;
+    for (int id = MINID; id <= MAXID; id++)
+        ships.push_back(Ship(id, static_cast<SHIPTYPE>(id % 5), (id % 3 == 0) ? LOST : ALIVE));
+
+    bool correct = true;
+    Fleet reference(AVL);
+    reference.insertBatch(ships.data(), ships.size());
+    int cores = thread::hardware_concurrency();
+    cout << "(";
+    for (int threads = 1; threads <= cores || threads <= 4; threads *= 2) {
+        Fleet fleet(AVL);
+        fleet.setThreads(threads);
+        Fleet copy;
+
+        chrono::steady_clock::time_point start = chrono::steady_clock::now();
+        fleet.insertBatch(ships.data(), ships.size());
+        chrono::steady_clock::time_point built = chrono::steady_clock::now();
+        copy = fleet;
+        chrono::steady_clock::time_point copied = chrono::steady_clock::now();
+        bool valid = copy.validate();
+        chrono::steady_clock::time_point validated = chrono::steady_clock::now();
+
+        bool identical = true;
+        checkIfIdentical(reference.m_root, fleet.m_root, identical);
+        checkIfIdentical(reference.m_root, copy.m_root, identical);
+        bool ifSizesCorrect = true;
+        checkSizes(copy.m_root, ifSizesCorrect);
+        correct = correct && valid && identical && ifSizesCorrect && copy.getThreads() == threads &&
+                  copy.size() == IDCOUNT && checkShips(copy, ships);
+
+        // A broken height, size or order deep down the tree must be found
+        Ship* node = copy.m_root;
+        for (int i = 0; i < 10; i++)
+            node = (i % 2 == 0) ? node->getLeft() : node->getRight();
+        node->setHeight(node->getHeight() + 1);
+        correct = correct && !copy.validate();
+        node->setHeight(node->getHeight() - 1);
+        node->setSize(node->getSize() - 1);
+        correct = correct && !copy.validate();
+        node->setSize(node->getSize() + 1);
+        node->setID(node->getID() + 1);
+        correct = correct && !copy.validate();
+        node->setID(node->getID() - 1);
+        correct = correct && copy.validate();
+
+        chrono::duration<double, micro> buildTime = built - start;
+        chrono::duration<double, micro> copyTime = copied - built;
+        chrono::duration<double, micro> validateTime = validated - copied;
+        cout << (threads > 1 ? ", " : "") << threads << " threads: build " << int(buildTime.count())
+             << " us, copy " << int(copyTime.count()) << " us, validate " << int(validateTime.count()) << " us";
+    }
+    cout << ") ";
+
+    // Validation also covers the other tree types and shared snapshots
+    TREETYPE types[3] = {BST, SPLAY, DENSE};
+    for (int t = 0; t < 3; t++) {
+        Fleet fleet(types[t]);
+        fleet.setThreads(4);
+        for (int i = 0; i < 20000; i++)
+            fleet.insert(Ship(uniqueIDs[i]));
+        Fleet snapshot = fleet.snapshot();
+        for (int i = 0; i < 20000; i += 2)
+            fleet.remove(uniqueIDs[i]);
+        correct = correct && fleet.validate() && snapshot.validate() && snapshot.getThreads() == 4;
+    }
+    return correct;
+}
+
+// Tests split and join, and the union, intersection and difference of fleets of every
+// type against a model, with every duplicate policy, the index and aggregates on,
+// snapshots taken beforehand and several threads
+bool Tester::testSetOperations() {
+    Random idGen(MINID, MAXID, SHUFFLE);
+    vector<int> uniqueIDs;
+    idGen.getShuffle(uniqueIDs);
+
+    // Two fleets sharing 500 IDs with different types and states
+    vector<Ship> first;
+    vector<Ship> second;
+    for (int i = 0; i < 3000; i++)
+        first.push_back(Ship(uniqueIDs[i], static_cast<SHIPTYPE>(i % 5), (i % 3 == 0) ? LOST : ALIVE));
+    for (int i = 2500; i < 3500; i++)
+        second.push_back(Ship(uniqueIDs[i], static_cast<SHIPTYPE>((i + 1) % 5), (i % 2 == 0) ? LOST : ALIVE));
+    vector<Ship> sortedFirst = expectedSetOperation(first, vector<Ship>(), 0, KEEPLEFT);
+
+    bool correct = true;
+    TREETYPE types[4] = {BST, AVL, SPLAY, DENSE};
+    TREETYPE otherTypes[2] = {AVL, DENSE};
+    DUPLICATE policies[3] = {KEEPLEFT, KEEPRIGHT, MERGESTATE};
+    for (int t = 0; t < 4; t++) {
+        for (int o = 0; o < 2; o++) {
+            for (int operation = 0; operation < 3; operation++) {
+                for (int p = 0; p < 3; p++) {
+                    Fleet fleet(types[t]);
+                    fleet.setIndexed(true);
+                    fleet.setAggregated(types[t] != DENSE);
+                    for (size_t i = 0; i < first.size(); i++)
+                        fleet.insert(first[i]);
+                    Fleet other(otherTypes[o]);
+                    for (size_t i = 0; i < second.size(); i++)
+                        other.insert(second[i]);
+                    Fleet before = fleet.snapshot();
+
+                    if (operation == 0)
+                        fleet.unionWith(other, policies[p]);
+                    else if (operation == 1)
+                        fleet.intersectWith(other, policies[p]);
+                    else
+                        fleet.differenceWith(other);
+
+                    correct = correct && checkSetOperation(fleet, expectedSetOperation(first, second, operation, policies[p])) &&
+                              checkShips(before, sortedFirst) && before.validate() && other.size() == 1000;
+                }
+            }
+        }
+    }
+
+    // Large AVL fleets on four threads, with and without a snapshot sharing the pool
+    vector<Ship> large;
+    vector<Ship> overlapping;
+    for (int i = 0; i < 40000; i++)
+        large.push_back(Ship(uniqueIDs[i], static_cast<SHIPTYPE>(i % 5), (i % 7 == 0) ? LOST : ALIVE));
+    for (int i = 20000; i < 60000; i++)
+        overlapping.push_back(Ship(uniqueIDs[i], static_cast<SHIPTYPE>(i % 4), (i % 2 == 0) ? LOST : ALIVE));
+    for (int operation = 0; operation < 3; operation++) {
+        for (int shared = 0; shared < 2; shared++) {
+            Fleet fleet(AVL);
+            fleet.setThreads(4);
+            fleet.setIndexed(true);
+            fleet.setAggregated(true);
+            fleet.insertBatch(large.data(), large.size());
+            Fleet other(AVL);
+            other.insertBatch(overlapping.data(), overlapping.size());
+            Fleet before = (shared == 1) ? fleet.snapshot() : Fleet();
+
+            if (operation == 0)
+                fleet.unionWith(other, MERGESTATE);
+            else if (operation == 1)
+                fleet.intersectWith(other, KEEPRIGHT);
+            else
+                fleet.differenceWith(other);
+
+            DUPLICATE policy = (operation == 1) ? KEEPRIGHT : MERGESTATE;
+            correct = correct && checkSetOperation(fleet, expectedSetOperation(large, overlapping, operation, policy)) &&
+                      (shared == 0 || before.size() == 40000);
+        }
+    }
+
+    // A degenerate BST is rebuilt first rather than recursed through
+    Fleet chain(BST);
+    for (int id = MINID; id < MINID + 20000; id++)
+        chain.insert(Ship(id));
+    Fleet tail(AVL);
+    for (int id = MINID + 19000; id < MINID + 21000; id++)
+        tail.insert(Ship(id, TELESCOPE));
+    chain.unionWith(tail, KEEPRIGHT);
+    correct = correct && chain.size() == 21000 && chain.validate() && chain.countByType(TELESCOPE) == 2000;
+
+    // Combining a fleet with itself
+    Fleet self(AVL);
+    for (int i = 0; i < 100; i++)
+        self.insert(first[i]);
+    self.unionWith(self);
+    self.intersectWith(self);
+    correct = correct && self.size() == 100 && self.validate();
+    self.differenceWith(self);
+    correct = correct && self.size() == 0 && self.getType() == AVL;
+
+    for (int t = 0; t < 4; t++) {
+        // Split in the middle into a fleet that loses its old ships, then join back
+        Fleet fleet(types[t]);
+        fleet.setIndexed(true);
+        fleet.setAggregated(types[t] != DENSE);
+        for (size_t i = 0; i < first.size(); i++)
+            fleet.insert(first[i]);
+        Fleet before = fleet.snapshot();
+        Fleet right(BST);
+        right.setIndexed(true);
+        right.setAggregated(true);
+        right.insert(Ship(MINID));
+
+        int pivot = sortedFirst[1200].getID();
+        fleet.split(pivot, right, true);
+        vector<Ship> lower(sortedFirst.begin(), sortedFirst.begin() + 1200);
+        vector<Ship> upper(sortedFirst.begin() + 1200, sortedFirst.end());
+        correct = correct && right.getType() == types[t] && checkSetOperation(fleet, lower) &&
+                  checkSetOperation(right, upper) && checkShips(before, sortedFirst) &&
+                  (types[t] == DENSE || right.m_pool == fleet.m_pool);
+
+        fleet.join(right);
+        correct = correct && checkSetOperation(fleet, sortedFirst) && right.size() == 0 && right.validate() &&
+                  checkShips(before, sortedFirst);
+
+        // Splitting just after a ship or past either end
+        fleet.split(pivot + 1, right);
+        fleet.join(right);
+        correct = correct && checkSetOperation(fleet, sortedFirst);
+        fleet.split(MINID, right);
+        correct = correct && fleet.size() == 0 && right.size() == 3000;
+        right.split(MAXID + 1, fleet);
+        correct = correct && fleet.size() == 0 && checkSetOperation(right, sortedFirst);
+    }
+
+    // Joining fleets with their own pools takes over the pool, or copies it if a
+    // snapshot still uses it, and overlapping IDs fall back to a union
+    vector<Ship> lowShips(sortedFirst.begin(), sortedFirst.begin() + 2000);
+    vector<Ship> highShips(sortedFirst.begin() + 2000, sortedFirst.end());
+    Fleet low(AVL);
+    Fleet high(AVL);
+    low.insertBatch(lowShips.data(), lowShips.size());
+    high.insertBatch(highShips.data(), highShips.size());
+    int slabs = low.m_pool->getSlabCount() + high.m_pool->getSlabCount();
+    low.join(high);
+    correct = correct && checkSetOperation(low, sortedFirst) && low.m_pool->getSlabCount() == slabs &&
+              high.size() == 0 && high.m_pool->getSlabCount() == 0;
+
+    Fleet lowAgain(AVL);
+    lowAgain.insertBatch(lowShips.data(), lowShips.size());
+    high.insertBatch(highShips.data(), highShips.size());
+    Fleet highBefore = high.snapshot();
+    lowAgain.join(high);
+    correct = correct && checkSetOperation(lowAgain, sortedFirst) && high.size() == 0 &&
+              checkShips(highBefore, highShips);
+
+    high.insertBatch(highShips.data(), highShips.size());
+    high.join(low);
+    correct = correct && checkSetOperation(high, sortedFirst) && low.size() == 0;
+
+    // Taking over a BST vine or a splay tree keeps an AVL fleet balanced
+    const TREETYPE others[2] = {BST, SPLAY};
+    const int sizes[2][2] = {{10, 8}, {100, 20}};
+    for (int o = 0; o < 2; o++) {
+        int leftSize = sizes[o][0];
+        int rightSize = sizes[o][1];
+        vector<Ship> leftShips(sortedFirst.begin(), sortedFirst.begin() + leftSize);
+        vector<Ship> joined(sortedFirst.begin(), sortedFirst.begin() + leftSize + rightSize);
+        Fleet avl(AVL);
+        avl.setIndexed(true);
+        avl.setAggregated(true);
+        avl.insertBatch(leftShips.data(), leftShips.size());
+        Fleet other(others[o]);
+        for (int i = leftSize; i < leftSize + rightSize; i++)
+            other.insert(sortedFirst[i]);
+        avl.join(other);
+        correct = correct && checkSetOperation(avl, joined) && other.size() == 0;
+    }
+
+    // Splitting without sharing the pool, the default, leaves both fleets independent
+    Fleet shared(AVL);
+    shared.setIndexed(true);
+    shared.setAggregated(true);
+    shared.insertBatch(sortedFirst.data(), sortedFirst.size());
+    Fleet own(AVL);
+    own.setIndexed(true);
+    own.setAggregated(true);
+    shared.split(sortedFirst[2000].getID(), own);
+    correct = correct && shared.m_pool != own.m_pool && shared.m_pool->getUsers() == 1 &&
+              own.m_pool->getUsers() == 1 && checkSetOperation(shared, lowShips) &&
+              checkSetOperation(own, highShips);
+    shared.clear();
+    correct = correct && checkSetOperation(own, highShips);
+    return correct;
+}
+
+// Returns the ships of an operation (0 union, 1 intersection, 2 difference) of two
+// fleets in ID order, computed on arrays indexed by ID
+vector<Ship> Tester::expectedSetOperation(const vector<Ship>& left, const vector<Ship>& right, int operation, DUPLICATE policy) {
+    vector<int> leftData(IDCOUNT, -1);
+    vector<int> rightData(IDCOUNT, -1);
+    for (size_t i = 0; i < left.size(); i++)
+        leftData[left[i].getID() - MINID] = left[i].getType() * 2 + left[i].getState();
+    for (size_t i = 0; i < right.size(); i++)
+        rightData[right[i].getID() - MINID] = right[i].getType() * 2 + right[i].getState();
+
+    vector<Ship> ships;
+    for (int offset = 0; offset < IDCOUNT; offset++) {
+        int l = leftData[offset];
+        int r = rightData[offset];
+        int kept = -1;
+        if (l >= 0 && r >= 0 && operation != 2) {
+            if (policy == KEEPLEFT)
+                kept = l;
+            else if (policy == KEEPRIGHT)
+                kept = r;
+            else
+                kept = (l / 2) * 2 + (l % 2 | r % 2);
+        }
+        else if (l >= 0 && r < 0 && operation != 1)
+            kept = l;
+        else if (l < 0 && r >= 0 && operation == 0)
+            kept = r;
+
+        if (kept >= 0)
+            ships.push_back(Ship(offset + MINID, static_cast<SHIPTYPE>(kept / 2), static_cast<STATE>(kept % 2)));
+    }
+    return ships;
+}
+
+// Checks that a fleet holds exactly the expected ships, passes validation and has its
+// index counts and aggregates in step with them
+bool Tester::checkSetOperation(const Fleet& fleet, const vector<Ship>& expected) {
+    int counts[5][2] = {};
+    int lowerCounts[5][2] = {};
+    int middle = expected.empty() ? MINID : expected[expected.size() / 2].getID();
+    for (size_t i = 0; i < expected.size(); i++) {
+        counts[expected[i].getType()][expected[i].getState()]++;
+        if (expected[i].getID() < middle)
+            lowerCounts[expected[i].getType()][expected[i].getState()]++;
+    }
+
+    bool correct = checkShips(fleet, expected) && fleet.validate();
+    int aggregated[5][2];
+    fleet.aggregateRange(MINID, middle - 1, aggregated);
+    correct = correct && sameCounts(aggregated, lowerCounts);
+    for (int type = 0; type < 5; type++) {
+        for (int state = 0; state < 2; state++)
+            correct = correct && fleet.count(static_cast<SHIPTYPE>(type), static_cast<STATE>(state)) == counts[type][state];
+    }
+    return correct;
+}
+
+// Tests that removeRange deletes exactly the ships of a range in every tree type,
+// keeps the index, aggregates and snapshots right and returns the nodes to the pool
+bool Tester::testRemoveRange() {
+    Random idGen(MINID, MAXID, SHUFFLE);
+    vector<int> uniqueIDs;
+    idGen.getShuffle(uniqueIDs);
+    vector<Ship> inserted;
+    for (int i = 0; i < 5000; i++)
+        inserted.push_back(Ship(uniqueIDs[i], static_cast<SHIPTYPE>(i % 5), (i % 3 == 0) ? LOST : ALIVE));
+    vector<Ship> ships = expectedSetOperation(inserted, vector<Ship>(), 0, KEEPLEFT);
+
+    bool correct = true;
+    TREETYPE types[4] = {BST, AVL, SPLAY, DENSE};
+    Random rangeGen(MINID - 100, MAXID + 100);
+    for (int t = 0; t < 4; t++) {
+        Fleet fleet(types[t]);
+        fleet.setIndexed(true);
+        fleet.setAggregated(types[t] != DENSE);
+        for (size_t i = 0; i < inserted.size(); i++)
+            fleet.insert(inserted[i]);
+        Fleet before = fleet.snapshot();
+
+        // Random ranges, some past either end or empty, the last one inverted
+        vector<Ship> expected = ships;
+        for (int round = 0; round < 20; round++) {
+            int lo = rangeGen.getRandNum();
+            int hi = (round == 19) ? lo - 1 : lo + rangeGen.getRandNum() % 5000;
+            fleet.removeRange(lo, hi);
+
+            vector<Ship> kept;
+            for (size_t i = 0; i < expected.size(); i++) {
+                if (expected[i].getID() < lo || expected[i].getID() > hi)
+                    kept.push_back(expected[i]);
+            }
+            expected = kept;
+            correct = correct && checkSetOperation(fleet, expected);
+        }
+        correct = correct && checkShips(before, ships);
+
+        // Ranges at the very ends and an existing ID on both bounds
+        int lo = expected.front().getID();
+        int hi = expected[expected.size() / 2].getID();
+        fleet.removeRange(lo, hi);
+        expected.erase(expected.begin(), expected.begin() + expected.size() / 2 + 1);
+        correct = correct && checkSetOperation(fleet, expected);
+        fleet.removeRange(MINID, MAXID);
+        correct = correct && fleet.size() == 0 && fleet.validate() && checkShips(before, ships);
+    }
+
+    // Without a snapshot the released nodes are reused, the pool doesn't grow back
+    Fleet fleet(AVL);
+    fleet.insertBatch(ships.data(), ships.size());
+    int slabs = fleet.m_pool->getSlabCount();
+    fleet.removeRange(ships[1000].getID(), ships[3999].getID());
+    for (int i = 1000; i < 4000; i++)
+        fleet.insert(ships[i]);
+    correct = correct && checkSetOperation(fleet, ships) && fleet.m_pool->getSlabCount() == slabs;
+    return correct;
+}
+
+// Tests that removeBatch deletes exactly the given ships, whatever their order,
+// duplicates and IDs out of range, in every tree type, on several threads and
+// through the concurrent wrapper, keeping the index, aggregates and snapshots right
+bool Tester::testRemoveBatch() {
+    Random idGen(MINID, MAXID, SHUFFLE);
+    vector<int> uniqueIDs;
+    idGen.getShuffle(uniqueIDs);
+    vector<Ship> inserted;
+    for (int i = 0; i < 5000; i++)
+        inserted.push_back(Ship(uniqueIDs[i], static_cast<SHIPTYPE>(i % 5), (i % 3 == 0) ? LOST : ALIVE));
+    vector<Ship> ships = expectedSetOperation(inserted, vector<Ship>(), 0, KEEPLEFT);
+
+    // Every third inserted ship, some absent IDs, repeats and IDs out of range
+    vector<int> ids;
+    vector<Ship> removed;
+    for (int i = 0; i < 5000; i += 3) {
+        ids.push_back(uniqueIDs[i]);
+        removed.push_back(inserted[i]);
+    }
+    for (int i = 5000; i < 5500; i++)
+        ids.push_back(uniqueIDs[i]);
+    for (int i = 0; i < 100; i++)
+        ids.push_back(ids[i * 7]);
+    ids.push_back(MINID - 1);
+    ids.push_back(MAXID + 1);
+    vector<Ship> expected = expectedSetOperation(ships, removed, 2, KEEPLEFT);
+
+    bool correct = true;
+    TREETYPE types[4] = {BST, AVL, SPLAY, DENSE};
+    for (int t = 0; t < 4; t++) {
+        Fleet fleet(types[t]);
+        fleet.setIndexed(true);
+        fleet.setAggregated(types[t] != DENSE);
+        for (size_t i = 0; i < inserted.size(); i++)
+            fleet.insert(inserted[i]);
+        Fleet before = fleet.snapshot();
+
+        fleet.removeBatch(ids.data(), ids.size());
+        correct = correct && checkSetOperation(fleet, expected) && checkShips(before, ships);
+        fleet.removeBatch(ids.data(), 0);
+        correct = correct && checkSetOperation(fleet, expected);
+
+        // Already sorted IDs are used as given
+        vector<int> sortedIDs;
+        for (size_t i = 0; i < expected.size(); i++)
+            sortedIDs.push_back(expected[i].getID());
+        fleet.removeBatch(sortedIDs.data(), sortedIDs.size());
+        correct = correct && fleet.size() == 0 && fleet.validate() && checkShips(before, ships);
+    }
+
+    // A large AVL fleet on four threads
+    Fleet fleet(AVL);
+    fleet.setThreads(4);
+    fleet.setIndexed(true);
+    fleet.insertBatch(inserted.data(), inserted.size());
+    vector<Ship> large;
+    for (int i = 5000; i < 60000; i++)
+        large.push_back(Ship(uniqueIDs[i], static_cast<SHIPTYPE>(i % 5), (i % 2 == 0) ? LOST : ALIVE));
+    fleet.insertBatch(large.data(), large.size());
+    vector<int> largeIDs(uniqueIDs.begin() + 2500, uniqueIDs.begin() + 40000);
+    vector<Ship> largeRemoved;
+    for (size_t i = 0; i < largeIDs.size(); i++) {
+        Ship ship;
+        fleet.peek(largeIDs[i], ship);
+        largeRemoved.push_back(ship);
+    }
+    vector<Ship> all = expectedSetOperation(inserted, large, 0, KEEPLEFT);
+    fleet.removeBatch(largeIDs.data(), largeIDs.size());
+    correct = correct && checkSetOperation(fleet, expectedSetOperation(all, largeRemoved, 2, KEEPLEFT));
+
+    // The concurrent wrapper removes a batch under one lock
+    ConcurrentFleet concurrent(AVL);
+    concurrent.insertBatch(inserted.data(), inserted.size());
+    concurrent.removeBatch(ids.data(), ids.size());
+    correct = correct && concurrent.size() == int(expected.size()) && !concurrent.contains(uniqueIDs[0]) &&
+              concurrent.contains(uniqueIDs[1]);
+    return correct;
+}
+
+// Tests that mergeSortedBatch inserts like insert in every tree type: new ships are
+// added, existing and earlier ships win duplicates and out of range IDs are skipped,
+// unsorted batches still work, and the index, aggregates and snapshots stay right.
+// Also times small batches against insertBatch, which rebuilds the whole tree
+bool Tester::testMergeSortedBatch() {
+    Random idGen(MINID, MAXID, SHUFFLE);
+    vector<int> uniqueIDs;
+    idGen.getShuffle(uniqueIDs);
+    vector<Ship> inserted;
+    for (int i = 0; i < 20000; i++)
+        inserted.push_back(Ship(uniqueIDs[i], static_cast<SHIPTYPE>(i % 5), (i % 3 == 0) ? LOST : ALIVE));
+    vector<Ship> existing = expectedSetOperation(inserted, vector<Ship>(), 0, KEEPLEFT);
+
+    // 3000 new ships and 1000 already in the fleet, sorted, with repeats and bad IDs
+    vector<Ship> fresh;
+    for (int i = 19000; i < 23000; i++)
+        fresh.push_back(Ship(uniqueIDs[i], TELESCOPE, LOST));
+    vector<Ship> batch = expectedSetOperation(fresh, vector<Ship>(), 0, KEEPLEFT);
+    vector<Ship> withRepeats;
+    withRepeats.push_back(Ship(MINID - 1));
+    for (size_t i = 0; i < batch.size(); i++) {
+        withRepeats.push_back(batch[i]);
+        if (i % 10 == 0)
+            withRepeats.push_back(Ship(batch[i].getID(), CARGO, ALIVE));
+    }
+    withRepeats.push_back(Ship(MAXID + 1));
+    vector<Ship> expected = expectedSetOperation(existing, batch, 0, KEEPLEFT);
+
+    bool correct = true;
+    TREETYPE types[4] = {BST, AVL, SPLAY, DENSE};
+    for (int t = 0; t < 4; t++) {
+        for (int shuffled = 0; shuffled < 2; shuffled++) {
+            Fleet fleet(types[t]);
+            fleet.setIndexed(true);
+            fleet.setAggregated(types[t] != DENSE);
+            for (size_t i = 0; i < inserted.size(); i++)
+                fleet.insert(inserted[i]);
+            Fleet before = fleet.snapshot();
+
+            vector<Ship> ships = withRepeats;
+            vector<Ship> merged = expected;
+            if (shuffled == 1) {
+                // Reversed, the repeated CARGO copies come first and win
+                reverse(ships.begin(), ships.end());
+                vector<Ship> cargo;
+                for (size_t i = 0; i < batch.size(); i += 10)
+                    cargo.push_back(Ship(batch[i].getID(), CARGO, ALIVE));
+                merged = expectedSetOperation(existing, expectedSetOperation(cargo, batch, 0, KEEPLEFT), 0, KEEPLEFT);
+            }
+            fleet.mergeSortedBatch(ships.data(), ships.size());
+            correct = correct && checkSetOperation(fleet, merged) && checkShips(before, existing);
+        }
+    }
+
+    // On four threads
+    Fleet fleet(AVL);
+    fleet.setThreads(4);
+    fleet.insertBatch(inserted.data(), inserted.size());
+    vector<Ship> large;
+    for (int i = 10000; i < 60000; i++)
+        large.push_back(Ship(uniqueIDs[i], FUELCARRIER, ALIVE));
+    large = expectedSetOperation(large, vector<Ship>(), 0, KEEPLEFT);
+    fleet.mergeSortedBatch(large.data(), large.size());
+    correct = correct && checkSetOperation(fleet, expectedSetOperation(existing, large, 0, KEEPLEFT));
+
+    // Small sorted batches into a large fleet
+    vector<Ship> all;
+    for (int i = 0; i < 80000; i++)
+        all.push_back(Ship(uniqueIDs[i]));
+    vector<Ship> small;
+    for (int i = 80000; i < 80100; i++)
+        small.push_back(Ship(uniqueIDs[i]));
+    small = expectedSetOperation(small, vector<Ship>(), 0, KEEPLEFT);
+    long mergeTime = timeBatchInsert(all, small, true);
+    long insertTime = timeBatchInsert(all, small, false);
+    cout << "(100 into 80000 ships: merge " << mergeTime << " us, insertBatch " << insertTime << " us) ";
+    return correct;
+}
+
+// Times inserting a batch into a fleet built from existing ships 10 times, with
+// mergeSortedBatch or insertBatch, in microseconds
+long Tester::timeBatchInsert(const vector<Ship>& existing, const vector<Ship>& batch, bool merge) {
+    Fleet fleet(AVL);
+    fleet.insertBatch(existing.data(), existing.size());
+    chrono::duration<double, micro> elapsed(0);
+    for (int round = 0; round < 10; round++) {
+        Fleet copy = fleet;
+        chrono::steady_clock::time_point start = chrono::steady_clock::now();
+        if (merge)
+            copy.mergeSortedBatch(batch.data(), batch.size());
+        else
+            copy.insertBatch(batch.data(), batch.size());
+        elapsed += chrono::steady_clock::now() - start;
+    }
+    return long(elapsed.count());
+}
+
+// Tests that save and load round-trip fleets of every type with their exact tree shape,
+// keep the settings of the loading fleet, load a full fleet quickly and reject missing,
+// corrupted, truncated and newer files without touching the fleet
+bool Tester::testSaveAndLoad() {
+    Random idGen(MINID, MAXID, SHUFFLE);
+    vector<int> uniqueIDs;
+    idGen.getShuffle(uniqueIDs);
+    vector<Ship> inserted;
+    for (int i = 0; i < 5000; i++)
+        inserted.push_back(Ship(uniqueIDs[i], static_cast<SHIPTYPE>(i % 5), (i % 3 == 0) ? LOST : ALIVE));
+    vector<Ship> ships = expectedSetOperation(inserted, vector<Ship>(), 0, KEEPLEFT);
+    const string path = "fleet_test.bin";
+
+    bool correct = true;
+    TREETYPE types[4] = {BST, AVL, SPLAY, DENSE};
+    for (int t = 0; t < 4; t++) {
+        Fleet fleet(types[t]);
+        for (size_t i = 0; i < inserted.size(); i++)
+            fleet.insert(inserted[i]);
+        correct = correct && fleet.save(path);
+
+        // The loading fleet keeps its own settings but takes the saved type
+        Fleet loaded(BST);
+        loaded.setIndexed(true);
+        loaded.setAggregated(true);
+        loaded.setThreads(2);
+        loaded.insert(Ship(MINID));
+        bool identical = true;
+        correct = correct && loaded.load(path);
+        checkIfIdentical(fleet.m_root, loaded.m_root, identical);
+        correct = correct && identical && loaded.getType() == types[t] && loaded.getThreads() == 2 &&
+                  loaded.isIndexed() && loaded.isAggregated() && checkSetOperation(loaded, ships);
+
+        // A snapshot of the loaded fleet keeps it while it changes
+        Fleet before = loaded.snapshot();
+        loaded.removeRange(MINID, MAXID);
+        correct = correct && checkShips(before, ships);
+    }
+
+    // Empty fleets, including a NONE one
+    Fleet empty;
+    Fleet loaded(AVL);
+    loaded.insert(Ship(MINID));
+    correct = correct && empty.save(path) && loaded.load(path) && loaded.size() == 0 && loaded.getType() == NONE;
+    Fleet emptyAVL(AVL);
+    correct = correct && emptyAVL.save(path) && loaded.load(path) && loaded.size() == 0 && loaded.getType() == AVL;
+
+    // A full degenerate BST round-trips without deep recursion, a full AVL fleet quickly
+    Fleet chain(SPLAY);
+    for (int id = MINID; id <= MAXID; id++)
+        chain.insert(Ship(id));
+    chain.setType(BST);
+    correct = correct && chain.save(path) && loaded.load(path) && loaded.size() == IDCOUNT &&
+              loaded.m_root->getHeight() == IDCOUNT - 1 && loaded.validate();
+
+    vector<Ship> all;
+    for (int id = MINID; id <= MAXID; id++)
+        all.push_back(Ship(id, static_cast<SHIPTYPE>(id % 5), (id % 2 == 0) ? LOST : ALIVE));
+    Fleet full(AVL);
+    full.insertBatch(all.data(), all.size());
+    correct = correct && full.save(path);
+    Fleet restarted;
+    chrono::steady_clock::time_point start = chrono::steady_clock::now();
+    correct = correct && restarted.load(path);
+    chrono::duration<double, micro> loadTime = chrono::steady_clock::now() - start;
+    cout << "(" << IDCOUNT << " ships loaded in " << int(loadTime.count()) << " us) ";
+    bool identical = true;
+    checkIfIdentical(full.m_root, restarted.m_root, identical);
+    correct = correct && identical && checkShips(restarted, all);
+
+    // Corrupted files are rejected and leave the fleet as it was
+    Fleet small(AVL);
+    for (int i = 0; i < 100; i++)
+        small.insert(inserted[i]);
+    small.save(path);
+    ifstream in(path.c_str(), ios::binary);
+    string bytes((istreambuf_iterator<char>(in)), istreambuf_iterator<char>());
+    in.close();
+    vector<string> corrupted;
+    corrupted.push_back(bytes.substr(0, bytes.size() - 4));   // truncated
+    corrupted.push_back(bytes.substr(0, 8));                  // header only
+    corrupted.push_back(bytes);
+    corrupted.back()[0] = 'X';                                // wrong magic number
+    corrupted.push_back(bytes);
+    corrupted.back()[4] = char(FLEETFILEVERSION + 1);         // newer version
+    corrupted.push_back(bytes);
+    corrupted.back()[8] = 9;                                  // unknown tree type
+    corrupted.push_back(bytes);
+    corrupted.back()[18] = char(0x40);                        // bits above the state
+    corrupted.push_back(bytes);
+    swap(corrupted.back()[20], corrupted.back()[24]);         // pre-order broken
+    swap(corrupted.back()[21], corrupted.back()[25]);
+    swap(corrupted.back()[22], corrupted.back()[26]);
+    corrupted.push_back(bytes);
+    for (int i = 0; i < 4; i++)
+        corrupted.back()[20 + i] = corrupted.back()[16 + i];  // repeated ID
+
+    Fleet kept(SPLAY);
+    kept.setIndexed(true);
+    for (int i = 0; i < 50; i++)
+        kept.insert(inserted[i]);
+    vector<Ship> keptShips = expectedSetOperation(vector<Ship>(inserted.begin(), inserted.begin() + 50), vector<Ship>(), 0, KEEPLEFT);
+    for (size_t i = 0; i < corrupted.size(); i++) {
+        ofstream out(path.c_str(), ios::binary | ios::trunc);
+        out << corrupted[i];
+        out.close();
+        correct = correct && !kept.load(path) && kept.getType() == SPLAY && checkSetOperation(kept, keptShips);
+    }
+    remove(path.c_str());
+    correct = correct && !kept.load(path) && checkSetOperation(kept, keptShips) && !kept.save("no_such_dir/fleet.bin");
+    return correct;
+}
+
 // Helper function to check if the BST property is preserved
 bool Tester::checkBSTProperty(Ship *root, int minID, int maxID) {
     if (root == nullptr)
@@ -513,6 +2603,14 @@ void Tester::checkIfIdentical(Ship *root1, Ship *root2, bool& identical) {
     checkIfIdentical(root1->getRight(), root2->getRight(), identical);
 }
 
+// Helper function that counts the ships of a tree
+int Tester::countShips(Ship* root) {
+    if (root == nullptr)
+        return 0;
+
+    return 1 + countShips(root->getLeft()) + countShips(root->getRight());
+}
+
 // Helper function that searches for a ship with a given ID in a fleet
 bool Tester::findShip(Ship* root, int shipID) {
     if (shipID >= MINID && shipID <= MAXID) {
@@ -587,6 +2685,68 @@ int main() {
 
     cout << "Testing assignment operator error case: " <<
             (tester.testAssignmentOperatorErrorCase() ? "Passed" : "Failed") << endl;
+
+    cout << "Testing AVL insert/remove performance: " <<
+            (tester.testAVLPerformance() ? "Passed" : "Failed") << endl;
+
+    cout << "Testing Splay insert/remove performance: " <<
+            (tester.testSplayPerformance() ? "Passed" : "Failed") << endl;
+
+    cout << "Testing find splays the accessed node: " <<
+            (tester.testFindSplaysNode() ? "Passed" : "Failed") << endl;
+
+    cout << "Testing peek does not restructure: " <<
+            (tester.testPeekDoesNotRestructure() ? "Passed" : "Failed") << endl;
+
+    cout << "Testing Splay remove: " << (tester.testSplayRemove() ? "Passed" : "Failed") << endl;
+
+    cout << "Testing node pool allocations: " << (tester.testPoolAllocations() ? "Passed" : "Failed") << endl;
+
+    cout << "Testing compact fleet matches AVL: " <<
+            (tester.testCompactFleetMatchesAVL() ? "Passed" : "Failed") << endl;
+
+    cout << "Testing DENSE mode: " << (tester.testDenseMode() ? "Passed" : "Failed") << endl;
+
+    cout << "Testing insert batch: " << (tester.testInsertBatch() ? "Passed" : "Failed") << endl;
+
+    cout << "Testing convert BST to AVL: " << (tester.testConvertToAVL() ? "Passed" : "Failed") << endl;
+
+    cout << "Testing degenerate BST is stack safe: " <<
+            (tester.testDegenerateBSTIsStackSafe() ? "Passed" : "Failed") << endl;
+
+    cout << "Testing iterators: " << (tester.testIterators() ? "Passed" : "Failed") << endl;
+
+    cout << "Testing order statistics: " << (tester.testOrderStatistics() ? "Passed" : "Failed") << endl;
+
+    cout << "Testing type and state index: " << (tester.testShipIndex() ? "Passed" : "Failed") << endl;
+    cout << "Testing index query performance: " << (tester.testIndexPerformance() ? "Passed" : "Failed") << endl;
+
+    cout << "Testing aggregate range: " << (tester.testAggregateRange() ? "Passed" : "Failed") << endl;
+
+    cout << "Testing copy and move: " << (tester.testCopyAndMove() ? "Passed" : "Failed") << endl;
+
+    cout << "Testing snapshots: " << (tester.testSnapshots() ? "Passed" : "Failed") << endl;
+
+    cout << "Testing concurrent fleet: " << (tester.testConcurrentFleet() ? "Passed" : "Failed") << endl;
+    cout << "Testing concurrent lookup throughput: " << (tester.testConcurrentThroughput() ? "Passed" : "Failed") << endl;
+
+    cout << "Testing locking fleet: " << (tester.testLockingFleet() ? "Passed" : "Failed") << endl;
+
+    cout << "Testing thread pool: " << (tester.testThreadPool() ? "Passed" : "Failed") << endl;
+    cout << "Testing sharded fleet: " << (tester.testShardedFleet() ? "Passed" : "Failed") << endl;
+    cout << "Testing sharded throughput: " << (tester.testShardedThroughput() ? "Passed" : "Failed") << endl;
+
+    cout << "Testing parallel bulk operations: " << (tester.testParallelBulkOperations() ? "Passed" : "Failed") << endl;
+
+    cout << "Testing set operations: " << (tester.testSetOperations() ? "Passed" : "Failed") << endl;
+
+    cout << "Testing remove range: " << (tester.testRemoveRange() ? "Passed" : "Failed") << endl;
+
+    cout << "Testing remove batch: " << (tester.testRemoveBatch() ? "Passed" : "Failed") << endl;
+
+    cout << "Testing merge sorted batch: " << (tester.testMergeSortedBatch() ? "Passed" : "Failed") << endl;
+
+    cout << "Testing save and load: " << (tester.testSaveAndLoad() ? "Passed" : "Failed") << endl;
     
     return 0;
 }
@@ -0,0 +1,144 @@
+// UMBC - CMSC 341 - Spring 2025 - Proj2
+#include "shardedfleet.h"
+
+// Constructor
+// Creates shards empty fleets of the given type and a pool of threads threads,
+// one per core if threads is 0
+ShardedFleet::ShardedFleet(TREETYPE type, int shards, int threads)
+    : m_shards(nullptr), m_shardCount(shards > 0 ? shards : 1),
+      m_pool(threads > 0 ? threads : int(thread::hardware_concurrency())){
+    m_shards = new ConcurrentFleet*[m_shardCount];
+    for (int i = 0; i < m_shardCount; i++)
+        m_shards[i] = new ConcurrentFleet(type);
+}
+
+// Destructor
+ShardedFleet::~ShardedFleet(){
+    for (int i = 0; i < m_shardCount; i++)
+        delete m_shards[i];
+    delete[] m_shards;
+}
+
+// Removes every ship, shard by shard
+void ShardedFleet::clear(){
+    m_pool.run(m_shardCount, [this](int shard) {m_shards[shard]->clear();});
+}
+
+// Inserts a ship into its shard
+void ShardedFleet::insert(const Ship& ship){
+    if (ship.getID() >= MINID && ship.getID() <= MAXID)
+        m_shards[shardOf(ship.getID())]->insert(ship);
+}
+
+// Splits the batch by shard, keeping the order within each shard, and inserts
+// every part with one batch insert per shard in parallel
+void ShardedFleet::insertBatch(const Ship* ships, size_t n){
+    int* starts = new int[m_shardCount + 1]();
+    for (size_t i = 0; i < n; i++) {
+        if (ships[i].getID() >= MINID && ships[i].getID() <= MAXID)
+            starts[shardOf(ships[i].getID()) + 1]++;
+    }
+    for (int i = 0; i < m_shardCount; i++)
+        starts[i + 1] += starts[i];
+
+    Ship* parts = new Ship[starts[m_shardCount]];
+    int* ends = new int[m_shardCount];
+    for (int i = 0; i < m_shardCount; i++)
+        ends[i] = starts[i];
+    for (size_t i = 0; i < n; i++) {
+        if (ships[i].getID() >= MINID && ships[i].getID() <= MAXID)
+            parts[ends[shardOf(ships[i].getID())]++] = ships[i];
+    }
+
+    m_pool.run(m_shardCount, [&](int shard) {
+        m_shards[shard]->insertBatch(parts + starts[shard], starts[shard + 1] - starts[shard]);
+    });
+    delete[] ends;
+    delete[] parts;
+    delete[] starts;
+}
+
+// Removes a ship from its shard
+void ShardedFleet::remove(int id){
+    if (id >= MINID && id <= MAXID)
+        m_shards[shardOf(id)]->remove(id);
+}
+
+// Splits the IDs by shard and removes every part in parallel, one task per shard
+void ShardedFleet::removeBatch(const int* ids, size_t n){
+    int* starts = new int[m_shardCount + 1]();
+    for (size_t i = 0; i < n; i++) {
+        if (ids[i] >= MINID && ids[i] <= MAXID)
+            starts[shardOf(ids[i]) + 1]++;
+    }
+    for (int i = 0; i < m_shardCount; i++)
+        starts[i + 1] += starts[i];
+
+    int* parts = new int[starts[m_shardCount]];
+    int* ends = new int[m_shardCount];
+    for (int i = 0; i < m_shardCount; i++)
+        ends[i] = starts[i];
+    for (size_t i = 0; i < n; i++) {
+        if (ids[i] >= MINID && ids[i] <= MAXID)
+            parts[ends[shardOf(ids[i])]++] = ids[i];
+    }
+
+    m_pool.run(m_shardCount, [&](int shard) {
+        m_shards[shard]->removeBatch(parts + starts[shard], starts[shard + 1] - starts[shard]);
+    });
+    delete[] ends;
+    delete[] parts;
+    delete[] starts;
+}
+
+// Looks up a ship in its shard, see ConcurrentFleet::find
+bool ShardedFleet::find(int id, Ship& ship){
+    if (id < MINID || id > MAXID)
+        return false;
+
+    return m_shards[shardOf(id)]->find(id, ship);
+}
+
+// Returns true if a ship with the given ID is in the fleet
+bool ShardedFleet::contains(int id) const{
+    if (id < MINID || id > MAXID)
+        return false;
+
+    return m_shards[shardOf(id)]->contains(id);
+}
+
+// Copies the ship with the given ID into ship, never restructures a shard
+bool ShardedFleet::peek(int id, Ship& ship) const{
+    if (id < MINID || id > MAXID)
+        return false;
+
+    return m_shards[shardOf(id)]->peek(id, ship);
+}
+
+// Returns the number of ships, the sum of the shard sizes
+int ShardedFleet::size() const{
+    int total = 0;
+    for (int i = 0; i < m_shardCount; i++)
+        total += m_shards[i]->size();
+    return total;
+}
+
+// Returns the number of ships with IDs in [lo, hi], asking only the shards the range overlaps
+int ShardedFleet::countInRange(int lo, int hi) const{
+    if (lo < MINID)
+        lo = MINID;
+    if (hi > MAXID)
+        hi = MAXID;
+    if (lo > hi)
+        return 0;
+
+    int total = 0;
+    for (int i = shardOf(lo); i <= shardOf(hi); i++)
+        total += m_shards[i]->countInRange(lo, hi);
+    return total;
+}
+
+// Returns the index of the shard whose ID range holds id
+int ShardedFleet::shardOf(int id) const{
+    return int((long long)(id - MINID) * m_shardCount / IDCOUNT);
+}
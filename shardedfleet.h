@@ -0,0 +1,46 @@
+// UMBC - CMSC 341 - Spring 2025 - Proj2
+#ifndef SHARDEDFLEET_H
+#define SHARDEDFLEET_H
+#include "concurrentfleet.h"
+#include "threadpool.h"
+
+// Fleet split into shards covering contiguous, equal ranges of the ID space. Every
+// shard is a concurrent fleet with its own lock and node pool, so operations on
+// different shards never wait for each other. Single ship operations are routed
+// by ID, batches are split by shard and run on a thread pool, one task per shard,
+// and forEach visits the shards in order, which keeps every ship in ID order.
+class ShardedFleet{
+    public:
+    friend class Grader;
+    friend class Tester;
+    ShardedFleet(TREETYPE type, int shards, int threads = 0);
+    ShardedFleet(const ShardedFleet&) = delete;
+    ShardedFleet& operator=(const ShardedFleet&) = delete;
+    ~ShardedFleet();
+    void clear();
+    void insert(const Ship& ship);
+    void insertBatch(const Ship* ships, size_t n);
+    void remove(int id);
+    void removeBatch(const int* ids, size_t n);
+    bool find(int id, Ship& ship);
+    bool contains(int id) const;
+    bool peek(int id, Ship& ship) const;
+    int size() const;
+    int countInRange(int lo, int hi) const;
+    int getShardCount() const {return m_shardCount;}
+    int shardOf(int id) const;
+    template <class Visitor>
+    void forEach(Visitor visit) const;
+    private:
+    ConcurrentFleet** m_shards; // the shards in ID order
+    int m_shardCount;           // the number of shards
+    ThreadPool m_pool;          // runs the per-shard tasks of batches
+};
+
+// Calls visit on every ship in ID order, one shard at a time under its reader lock
+template <class Visitor>
+void ShardedFleet::forEach(Visitor visit) const{
+    for (int i = 0; i < m_shardCount; i++)
+        m_shards[i]->forEach(visit);
+}
+#endif
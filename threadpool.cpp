@@ -0,0 +1,73 @@
+// UMBC - CMSC 341 - Spring 2025 - Proj2
+#include "threadpool.h"
+
+// Constructor
+// Starts threads - 1 workers, the thread calling run is the last one
+ThreadPool::ThreadPool(int threads) : m_threads(nullptr), m_threadCount(threads > 1 ? threads - 1 : 0),
+                                      m_task(nullptr), m_next(0), m_count(0), m_done(0),
+                                      m_generation(0), m_stopping(false){
+    if (m_threadCount > 0) {
+        m_threads = new thread[m_threadCount];
+        for (int i = 0; i < m_threadCount; i++)
+            m_threads[i] = thread(&ThreadPool::work, this);
+    }
+}
+
+// Destructor
+// Wakes every worker to exit and waits for them
+ThreadPool::~ThreadPool(){
+    {
+        lock_guard<mutex> guard(m_lock);
+        m_stopping = true;
+    }
+    m_wake.notify_all();
+    for (int i = 0; i < m_threadCount; i++)
+        m_threads[i].join();
+    delete[] m_threads;
+}
+
+// Calls task(i) for every i in [0, count) on the pool and waits until all are done
+void ThreadPool::run(int count, const function<void(int)>& task){
+    if (count <= 0)
+        return;
+
+    lock_guard<mutex> running(m_running);
+    unique_lock<mutex> lock(m_lock);
+    m_task = &task;
+    m_next = 0;
+    m_count = count;
+    m_done = 0;
+    m_generation++;
+    m_wake.notify_all();
+
+    runTasks(lock);
+    m_finished.wait(lock, [this]() {return m_done == m_count;});
+    m_task = nullptr;
+}
+
+// Body of a worker: waits for a loop, helps running it, and repeats until stopped
+void ThreadPool::work(){
+    unique_lock<mutex> lock(m_lock);
+    int generation = 0;
+    while (true) {
+        m_wake.wait(lock, [&]() {return m_stopping || (m_task != nullptr && m_generation != generation);});
+        if (m_stopping)
+            return;
+
+        generation = m_generation;
+        runTasks(lock);
+    }
+}
+
+// Takes indexes of the current loop until none are left, running each without the lock
+void ThreadPool::runTasks(unique_lock<mutex>& lock){
+    while (m_next < m_count) {
+        int index = m_next++;
+        const function<void(int)>* task = m_task;
+        lock.unlock();
+        (*task)(index);
+        lock.lock();
+        if (++m_done == m_count)
+            m_finished.notify_all();
+    }
+}
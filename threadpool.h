@@ -0,0 +1,42 @@
+// UMBC - CMSC 341 - Spring 2025 - Proj2
+#ifndef THREADPOOL_H
+#define THREADPOOL_H
+#include <condition_variable>
+#include <functional>
+#include <mutex>
+#include <thread>
+using namespace std;
+
+// Fixed set of worker threads running parallel loops. run(count, task) calls
+// task(0) .. task(count - 1) spread over the workers and the calling thread and
+// returns when all calls are done. Loops are run one at a time.
+class ThreadPool{
+    public:
+    ThreadPool(int threads);
+    ThreadPool(const ThreadPool&) = delete;
+    ThreadPool& operator=(const ThreadPool&) = delete;
+    ~ThreadPool();
+    void run(int count, const function<void(int)>& task);
+    int getThreads() const {return m_threadCount + 1;}
+    private:
+    thread* m_threads;                  // the workers
+    int m_threadCount;                  // the number of workers
+    mutex m_lock;                       // guards every member below
+    mutex m_running;                    // held by the caller of run for the whole loop
+    condition_variable m_wake;          // signals workers a new loop or shutdown
+    condition_variable m_finished;      // signals the caller that a task finished
+    const function<void(int)>* m_task;  // the loop being run, nullptr if none
+    int m_next;                         // the next index to hand out
+    int m_count;                        // the number of indexes of the loop
+    int m_done;                         // the number of finished indexes
+    int m_generation;                   // increases with every loop
+    bool m_stopping;                    // set when the workers must exit
+
+    // ***************************************************
+    // Any private helper functions must be declared here!
+    void work();
+
+    void runTasks(unique_lock<mutex>& lock);
+    // ***************************************************
+};
+#endif